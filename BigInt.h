@@ -2,55 +2,861 @@
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <cstdint>
 #include <algorithm> 
 
 namespace PositiveBigInt{
+    // size based dispatch of the multiplication engine, counted in limbs of the smaller factor
+    // toom3 from the full product timings: with 256 the 384 to 768 limb products are up to 1.7x slower,
+    // at 768 limbs both engines tie and from 1024 on 512 and 768 are equal within the noise
+    struct MulThresholds
+    {
+        size_t karatsuba = 32;
+        size_t toom3 = 768;
+    };
+    inline MulThresholds mul_thresholds;
+
+    // divisor and quotient need at least this many limbs before division goes through a Newton reciprocal
+    struct DivThresholds
+    {
+        size_t newton = 1536;
+        size_t inverse_basecase = 32;
+    };
+    inline DivThresholds div_thresholds;
+
+    namespace detail
+    {
+        // binary limbs, every intermediate of two limbs fits into the 64 bit accumulator
+        typedef uint32_t limb_t;
+        typedef unsigned long long dlimb_t;
+        static constexpr int limb_bits = 32;
+        static constexpr dlimb_t limb_base = dlimb_t(1) << limb_bits;
+        typedef std::vector<limb_t> Limbs;
+
+        // decimal digits per chunk of the radix conversion
+        static constexpr int chunk_digits = 9;
+        static constexpr limb_t chunk_base = 1e9;
+
+        // r = a + b, both of length n, returns carry
+        inline limb_t add_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+        {
+            dlimb_t keep = 0;
+            for( size_t i = 0; i < n; i++ )
+            {
+                const dlimb_t t = (dlimb_t)a[i] + b[i] + keep;
+                r[i] = (limb_t)t;
+                keep = t >> limb_bits;
+            }
+            return keep;
+        }
+
+        // r = a + b with an >= bn, returns carry
+        inline limb_t add(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            dlimb_t keep = add_n(r, a, b, bn);
+            for( size_t i = bn; i < an; i++ )
+            {
+                const dlimb_t t = (dlimb_t)a[i] + keep;
+                r[i] = (limb_t)t;
+                keep = t >> limb_bits;
+            }
+            return keep;
+        }
+
+        // r = a - b with an >= bn, returns borrow
+        inline limb_t sub(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            limb_t keep = 0;
+            for( size_t i = 0; i < an; i++ )
+            {
+                const dlimb_t bi = (dlimb_t)(i < bn ? b[i] : 0) + keep;
+                keep = a[i] < bi ? 1 : 0;
+                r[i] = (limb_t)(a[i] + keep * limb_base - bi);
+            }
+            return keep;
+        }
+
+        // r += a * m, returns the limb carried out of r[n-1]
+        inline limb_t addmul_1(limb_t* r, const limb_t* a, size_t n, limb_t m)
+        {
+            dlimb_t keep = 0;
+            for( size_t i = 0; i < n; i++ )
+            {
+                const dlimb_t t = (dlimb_t)a[i] * m + r[i] + keep;
+                r[i] = (limb_t)t;
+                keep = t >> limb_bits;
+            }
+            return keep;
+        }
+
+        // r = a * m, returns the carried out limb
+        inline limb_t mul_1(limb_t* r, const limb_t* a, size_t n, limb_t m)
+        {
+            dlimb_t keep = 0;
+            for( size_t i = 0; i < n; i++ )
+            {
+                const dlimb_t t = (dlimb_t)a[i] * m + keep;
+                r[i] = (limb_t)t;
+                keep = t >> limb_bits;
+            }
+            return keep;
+        }
+
+        // q = a / d, returns the remainder, q may alias a
+        inline limb_t divrem_1(limb_t* q, const limb_t* a, size_t n, limb_t d)
+        {
+            dlimb_t rem = 0;
+            for( size_t i = n; i-- > 0; )
+            {
+                const dlimb_t t = (rem << limb_bits) | a[i];
+                q[i] = (limb_t)(t / d);
+                rem = t % d;
+            }
+            return rem;
+        }
+
+        // adds a into r starting at r[0] and propagates the carry up to r[rn-1]
+        inline void add_into(limb_t* r, size_t rn, const limb_t* a, size_t an)
+        {
+            an = std::min(an, rn);
+            dlimb_t keep = add_n(r, r, a, an);
+            for( size_t i = an; keep != 0 && i < rn; i++ )
+            {
+                const dlimb_t t = (dlimb_t)r[i] + keep;
+                r[i] = (limb_t)t;
+                keep = t >> limb_bits;
+            }
+        }
+
+        inline void trim(Limbs& a)
+        {
+            while( a.size() > 1 && a.back() == 0 ) a.pop_back();
+        }
+
+        inline bool is_zero(const Limbs& a)
+        {
+            return a.size() == 1 && a[0] == 0;
+        }
+
+        inline int cmp(const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            if( an != bn ) return an > bn ? 1 : -1;
+            for( size_t i = an; i-- > 0; )
+            {
+                if( a[i] != b[i] ) return a[i] > b[i] ? 1 : -1;
+            }
+            return 0;
+        }
+
+        inline int cmp(const Limbs& a, const Limbs& b)
+        {
+            return cmp(a.data(), a.size(), b.data(), b.size());
+        }
+
+        inline int count_leading_zeros(limb_t x)
+        {
+            return x == 0 ? limb_bits : __builtin_clz(x);
+        }
+
+        void mul(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn);
+
+        // r[0, an+bn) = a * b, quadratic
+        inline void mul_basecase(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            std::fill(r, r + an + bn, 0);
+            for( size_t j = 0; j < bn; j++ )
+            {
+                r[an + j] = addmul_1(r + j, a, an, b[j]);
+            }
+        }
+
+        // one level of Karatsuba, requires an >= bn > (an+1)/2
+        inline void mul_karatsuba(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            const size_t h = (an + 1) / 2;
+            const size_t a1n = an - h;
+            const size_t b1n = bn - h;
+
+            Limbs sa(h + 1), sb(h + 1), z1(2 * h + 2);
+            sa[h] = add(sa.data(), a, h, a + h, a1n);
+            sb[h] = add(sb.data(), b, h, b + h, b1n);
+            mul(z1.data(), sa.data(), h + 1, sb.data(), h + 1);
+
+            std::fill(r, r + an + bn, 0);
+            mul(r, a, h, b, h);
+            if( a1n >= b1n ) mul(r + 2 * h, a + h, a1n, b + h, b1n);
+            else mul(r + 2 * h, b + h, b1n, a + h, a1n);
+
+            // z1 -= z0 + z2, the difference is never negative
+            sub(z1.data(), z1.data(), z1.size(), r, 2 * h);
+            sub(z1.data(), z1.data(), z1.size(), r + 2 * h, a1n + b1n);
+            add_into(r + h, an + bn - h, z1.data(), z1.size());
+        }
+
+        // magnitude and sign, only used for the Toom-3 evaluation and interpolation
+        struct SignedLimbs
+        {
+            Limbs v = Limbs(1);
+            bool neg = false;
+        };
+
+        inline Limbs add_v(const Limbs& a, const Limbs& b)
+        {
+            const Limbs& l = a.size() >= b.size() ? a : b;
+            const Limbs& s = a.size() >= b.size() ? b : a;
+            Limbs r(l.size() + 1);
+            r[l.size()] = add(r.data(), l.data(), l.size(), s.data(), s.size());
+            trim(r);
+            return r;
+        }
+
+        // requires a >= b
+        inline Limbs sub_v(const Limbs& a, const Limbs& b)
+        {
+            Limbs r(a.size());
+            sub(r.data(), a.data(), a.size(), b.data(), b.size());
+            trim(r);
+            return r;
+        }
+
+        inline SignedLimbs add_s(const SignedLimbs& a, const SignedLimbs& b)
+        {
+            SignedLimbs r;
+            if( a.neg == b.neg )
+            {
+                r.v = add_v(a.v, b.v);
+                r.neg = a.neg;
+            }
+            else if( cmp(a.v, b.v) >= 0 )
+            {
+                r.v = sub_v(a.v, b.v);
+                r.neg = a.neg;
+            }
+            else
+            {
+                r.v = sub_v(b.v, a.v);
+                r.neg = b.neg;
+            }
+            if( is_zero(r.v) ) r.neg = false;
+            return r;
+        }
+
+        inline SignedLimbs sub_s(const SignedLimbs& a, SignedLimbs b)
+        {
+            b.neg = !b.neg;
+            return add_s(a, b);
+        }
+
+        inline SignedLimbs mul_s(const SignedLimbs& a, const SignedLimbs& b)
+        {
+            SignedLimbs r;
+            r.v.assign(a.v.size() + b.v.size(), 0);
+            if( a.v.size() >= b.v.size() ) mul(r.v.data(), a.v.data(), a.v.size(), b.v.data(), b.v.size());
+            else mul(r.v.data(), b.v.data(), b.v.size(), a.v.data(), a.v.size());
+            trim(r.v);
+            r.neg = (a.neg != b.neg) && !is_zero(r.v);
+            return r;
+        }
+
+        inline SignedLimbs mul_small_s(SignedLimbs a, limb_t m)
+        {
+            a.v.push_back(0);
+            mul_1(a.v.data(), a.v.data(), a.v.size(), m);
+            trim(a.v);
+            return a;
+        }
+
+        // the division has to be exact
+        inline SignedLimbs divexact_small_s(SignedLimbs a, limb_t d)
+        {
+            divrem_1(a.v.data(), a.v.data(), a.v.size(), d);
+            trim(a.v);
+            return a;
+        }
+
+        inline SignedLimbs slice_s(const limb_t* a, size_t n)
+        {
+            SignedLimbs r;
+            r.v.assign(a, a + n);
+            trim(r.v);
+            return r;
+        }
+
+        // one level of Toom-3 with Bodrato's interpolation sequence, requires an >= bn > 2*ceil(an/3)
+        inline void mul_toom3(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            const size_t k = (an + 2) / 3;
+            const SignedLimbs a0 = slice_s(a, k), a1 = slice_s(a + k, k), a2 = slice_s(a + 2 * k, an - 2 * k);
+            const SignedLimbs b0 = slice_s(b, k), b1 = slice_s(b + k, k), b2 = slice_s(b + 2 * k, bn - 2 * k);
+
+            // evaluation at 0, 1, -1, -2 and infinity
+            const SignedLimbs pa = add_s(a0, a2);
+            const SignedLimbs pb = add_s(b0, b2);
+            const SignedLimbs a_1 = add_s(pa, a1), b_1 = add_s(pb, b1);
+            const SignedLimbs a_m1 = sub_s(pa, a1), b_m1 = sub_s(pb, b1);
+            const SignedLimbs a_m2 = sub_s(mul_small_s(add_s(a_m1, a2), 2), a0);
+            const SignedLimbs b_m2 = sub_s(mul_small_s(add_s(b_m1, b2), 2), b0);
+
+            const SignedLimbs w0 = mul_s(a0, b0);
+            const SignedLimbs w1 = mul_s(a_1, b_1);
+            const SignedLimbs wm1 = mul_s(a_m1, b_m1);
+            const SignedLimbs wm2 = mul_s(a_m2, b_m2);
+            const SignedLimbs winf = mul_s(a2, b2);
+
+            // interpolation
+            SignedLimbs r3 = divexact_small_s(sub_s(wm2, w1), 3);
+            SignedLimbs r1 = divexact_small_s(sub_s(w1, wm1), 2);
+            SignedLimbs r2 = sub_s(wm1, w0);
+            r3 = add_s(divexact_small_s(sub_s(r2, r3), 2), mul_small_s(winf, 2));
+            r2 = sub_s(add_s(r2, r1), winf);
+            r1 = sub_s(r1, r3);
+
+            const size_t rn = an + bn;
+            std::fill(r, r + rn, 0);
+            std::copy(w0.v.begin(), w0.v.begin() + std::min(w0.v.size(), rn), r);
+            add_into(r + k, rn - k, r1.v.data(), r1.v.size());
+            add_into(r + 2 * k, rn - 2 * k, r2.v.data(), r2.v.size());
+            add_into(r + 3 * k, rn - 3 * k, r3.v.data(), r3.v.size());
+            add_into(r + 4 * k, rn - 4 * k, winf.v.data(), winf.v.size());
+        }
+
+        // r[0, an+bn) = a * b for an >= bn >= 1, r must not overlap a or b
+        inline void mul(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            // below 4 limbs the Karatsuba halves would not shrink
+            if( bn < std::max<size_t>(mul_thresholds.karatsuba, 4) )
+            {
+                mul_basecase(r, a, an, b, bn);
+            }
+            else if( 2 * bn <= an + 1 )
+            {
+                // unbalanced, multiply b with slices of a of its own size
+                std::fill(r, r + an + bn, 0);
+                Limbs cache(2 * bn);
+                for( size_t i = 0; i < an; i += bn )
+                {
+                    const size_t n = std::min(bn, an - i);
+                    if( n >= bn ) mul(cache.data(), a + i, n, b, bn);
+                    else mul(cache.data(), b, bn, a + i, n);
+                    add_into(r + i, an + bn - i, cache.data(), n + bn);
+                }
+            }
+            else if( bn >= mul_thresholds.toom3 && bn > 2 * ((an + 2) / 3) )
+            {
+                mul_toom3(r, a, an, b, bn);
+            }
+            else
+            {
+                mul_karatsuba(r, a, an, b, bn);
+            }
+        }
+
+        inline Limbs mul_v(const Limbs& a, const Limbs& b)
+        {
+            Limbs r(a.size() + b.size());
+            if( a.size() >= b.size() ) mul(r.data(), a.data(), a.size(), b.data(), b.size());
+            else mul(r.data(), b.data(), b.size(), a.data(), a.size());
+            trim(r);
+            return r;
+        }
+
+        // Knuth's algorithm D, q[0, an-bn+1) = a / b and r[0, bn) = a % b for an >= bn >= 2, b[bn-1] != 0
+        inline void divrem_basecase(limb_t* q, limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+        {
+            const int s = count_leading_zeros(b[bn - 1]);
+            Limbs v(bn), u(an + 1);
+            for( size_t i = bn; i-- > 0; )
+            {
+                v[i] = (limb_t)(((dlimb_t)b[i] << s) | (s && i ? (dlimb_t)b[i - 1] >> (limb_bits - s) : 0));
+            }
+            u[an] = s ? (limb_t)((dlimb_t)a[an - 1] >> (limb_bits - s)) : 0;
+            for( size_t i = an; i-- > 0; )
+            {
+                u[i] = (limb_t)(((dlimb_t)a[i] << s) | (s && i ? (dlimb_t)a[i - 1] >> (limb_bits - s) : 0));
+            }
+
+            const dlimb_t v_top = v[bn - 1];
+            const dlimb_t v_next = v[bn - 2];
+            for( size_t j = an - bn + 1; j-- > 0; )
+            {
+                const dlimb_t numerator = ((dlimb_t)u[j + bn] << limb_bits) | u[j + bn - 1];
+                dlimb_t qhat = numerator / v_top;
+                dlimb_t rhat = numerator % v_top;
+                while( qhat >= limb_base || qhat * v_next > ((rhat << limb_bits) | u[j + bn - 2]) )
+                {
+                    qhat--;
+                    rhat += v_top;
+                    if( rhat >= limb_base ) break;
+                }
+
+                // u[j, j+bn] -= qhat * v
+                long long t = 0;
+                dlimb_t keep = 0;
+                for( size_t i = 0; i < bn; i++ )
+                {
+                    const dlimb_t p = qhat * v[i];
+                    t = (long long)u[i + j] - (long long)keep - (long long)(p & 0xFFFFFFFF);
+                    u[i + j] = (limb_t)t;
+                    keep = (p >> limb_bits) - (t >> limb_bits);
+                }
+                t = (long long)u[j + bn] - (long long)keep;
+                u[j + bn] = (limb_t)t;
+
+                q[j] = (limb_t)qhat;
+                if( t < 0 )
+                {
+                    // qhat was one too large, add v back
+                    q[j]--;
+                    u[j + bn] += add_n(&u[j], &u[j], v.data(), bn);
+                }
+            }
+
+            for( size_t i = 0; i < bn; i++ )
+            {
+                r[i] = (limb_t)(((dlimb_t)u[i] >> s) | (s ? (dlimb_t)u[i + 1] << (limb_bits - s) : 0));
+            }
+        }
+
+        // a * B^k
+        inline Limbs shifted(const Limbs& a, size_t k)
+        {
+            Limbs r(a.size() + k);
+            std::copy(a.begin(), a.end(), r.begin() + k);
+            trim(r);
+            return r;
+        }
+
+        // a / B^k
+        inline Limbs high(const Limbs& a, size_t k)
+        {
+            if( k >= a.size() ) return Limbs(1);
+            return Limbs(a.begin() + k, a.end());
+        }
+
+        inline Limbs power_of_base(size_t k)
+        {
+            Limbs r(k + 1);
+            r[k] = 1;
+            return r;
+        }
+
+        inline void divrem_small(Limbs& q, Limbs& r, const Limbs& a, const Limbs& b)
+        {
+            q.assign(a.size() - b.size() + 1, 0);
+            if( b.size() == 1 )
+            {
+                r = Limbs(1, divrem_1(q.data(), a.data(), a.size(), b[0]));
+            }
+            else
+            {
+                r.assign(b.size(), 0);
+                divrem_basecase(q.data(), r.data(), a.data(), a.size(), b.data(), b.size());
+            }
+            trim(q);
+            trim(r);
+        }
+
+        // approximately B^(m+p) / d for the m limbs of d, off by a few units at most
+        inline Limbs inverse(const Limbs& d, size_t p)
+        {
+            const size_t m = d.size();
+            // the limbs of d below p+2 do not change the result within that precision
+            if( m > p + 2 ) return inverse(Limbs(d.end() - (p + 2), d.end()), p);
+            if( p <= std::max<size_t>(div_thresholds.inverse_basecase, 4) )
+            {
+                Limbs q, r;
+                divrem_small(q, r, power_of_base(m + p), d);
+                return q;
+            }
+
+            // half precision start value, then one Newton step x += x * (B^(m+p) - d*x) / B^(m+p)
+            const size_t h = (p + 1) / 2 + 1;
+            const size_t l = std::min(m, h + 2);
+            SignedLimbs x;
+            x.v = shifted(inverse(Limbs(d.end() - l, d.end()), h), p - h);
+
+            SignedLimbs e, dx;
+            e.v = power_of_base(m + p);
+            dx.v = mul_v(d, x.v);
+            e = sub_s(e, dx);
+            // |e| < B^(m+p-h+1), so only the top h+2 limbs of x and of e reach the precision of the correction
+            const size_t sx = x.v.size() > h + 2 ? x.v.size() - (h + 2) : 0;
+            const size_t se = e.v.size() > h + 2 ? e.v.size() - (h + 2) : 0;
+            SignedLimbs xt = x, et = e;
+            xt.v = high(x.v, sx);
+            et.v = high(e.v, se);
+            SignedLimbs correction = mul_s(xt, et);
+            correction.v = high(correction.v, m + p - sx - se);
+            if( is_zero(correction.v) ) correction.neg = false;
+            return add_s(x, correction).v;
+        }
+
+        // floor(B^(m+p) / d) exactly
+        inline Limbs inverse_exact(const Limbs& d, size_t p)
+        {
+            Limbs x = inverse(d, p);
+            const Limbs bound = power_of_base(d.size() + p);
+            Limbs t = mul_v(d, x);
+            while( cmp(t, bound) > 0 )
+            {
+                x = sub_v(x, Limbs(1, 1));
+                t = sub_v(t, d);
+            }
+            while( cmp(add_v(t, d), bound) <= 0 )
+            {
+                x = add_v(x, Limbs(1, 1));
+                t = add_v(t, d);
+            }
+            return x;
+        }
+
+        // q = a / d through a reciprocal of d, then corrected by a few additions
+        inline void divrem_newton(Limbs& q, Limbs& r, const Limbs& a, const Limbs& d)
+        {
+            const size_t m = d.size();
+            const size_t p = a.size() - m + 1;
+            // the limbs of a below m-1 only move the quotient by a unit or two
+            q = high(mul_v(high(a, m - 1), inverse(d, p)), p + 1);
+
+            SignedLimbs rem, qd, ds;
+            rem.v = a;
+            qd.v = mul_v(q, d);
+            ds.v = d;
+            rem = sub_s(rem, qd);
+            while( rem.neg )
+            {
+                q = sub_v(q, Limbs(1, 1));
+                rem = add_s(rem, ds);
+            }
+            while( cmp(rem.v, d) >= 0 )
+            {
+                q = add_v(q, Limbs(1, 1));
+                rem.v = sub_v(rem.v, d);
+            }
+            r = rem.v;
+        }
+
+        // q = a / b and r = a % b for trimmed operands, b != 0
+        inline void divrem(Limbs& q, Limbs& r, const Limbs& a, const Limbs& b)
+        {
+            if( cmp(a, b) < 0 )
+            {
+                q = Limbs(1);
+                r = a;
+                return;
+            }
+            if( std::min(b.size(), a.size() - b.size() + 1) < div_thresholds.newton ) divrem_small(q, r, a, b);
+            else divrem_newton(q, r, a, b);
+        }
+
+        // floor(sqrt(n)), the root of the top half seeds Newton's iteration x = (x + n/x) / 2 from above
+        inline Limbs isqrt(const Limbs& n)
+        {
+            if( n.size() <= 2 )
+            {
+                const dlimb_t v = n[0] | (n.size() > 1 ? (dlimb_t)n[1] << limb_bits : 0);
+                dlimb_t r = std::min<dlimb_t>(std::sqrt((long double)v), 0xFFFFFFFF);
+                while( r * r > v ) r--;
+                while( r < 0xFFFFFFFF && (r + 1) * (r + 1) <= v ) r++;
+                Limbs res = {(limb_t)r, (limb_t)(r >> limb_bits)};
+                trim(res);
+                return res;
+            }
+
+            const size_t s = std::max<size_t>(n.size() / 4, 1);
+            Limbs x = shifted(add_v(isqrt(high(n, 2 * s)), Limbs(1, 1)), s);
+            while( true )
+            {
+                Limbs q, r;
+                divrem(q, r, n, x);
+                Limbs y = add_v(x, q);
+                divrem_1(y.data(), y.data(), y.size(), 2);
+                trim(y);
+                if( cmp(y, x) >= 0 ) return x;
+                x = y;
+            }
+        }
+
+        inline Limbs pow_small(limb_t base, unsigned long long exp)
+        {
+            Limbs res(1, 1);
+            Limbs factor(1, base);
+            while( exp > 0 )
+            {
+                if( exp & 1 ) res = mul_v(res, factor);
+                exp >>= 1;
+                if( exp > 0 ) factor = mul_v(factor, factor);
+            }
+            return res;
+        }
+
+        // q = a / d and r = a % d for a < B^(2m), with inv = floor(B^(2m) / d) for the m limbs of d;
+        // the quotient has at most qn limbs and only the top qn+2 limbs of a and of inv reach it,
+        // which leaves the estimate at most four below the quotient
+        inline void divrem_barrett(Limbs& q, Limbs& r, const Limbs& a, const Limbs& d, const Limbs& inv)
+        {
+            const size_t m = d.size();
+            if( a.size() < m )
+            {
+                q = Limbs(1);
+                r = a;
+                return;
+            }
+            const size_t qn = a.size() - m + 1;
+            const size_t sa = a.size() > qn + 2 ? a.size() - (qn + 2) : 0;
+            const size_t si = inv.size() > qn + 2 ? inv.size() - (qn + 2) : 0;
+            q = high(mul_v(high(a, sa), high(inv, si)), 2 * m - sa - si);
+            r = sub_v(a, mul_v(q, d));
+            while( cmp(r, d) >= 0 )
+            {
+                q = add_v(q, Limbs(1, 1));
+                r = sub_v(r, d);
+            }
+        }
+
+        // below this size the decimal conversion peels off 9 digit chunks one by one
+        static constexpr size_t to_decimal_threshold = 16;
+
+        // 10^(9*2^k) and its Barrett reciprocal, kept per thread since every conversion splits at the same powers
+        struct DecimalPowers
+        {
+            std::vector<Limbs> pow;
+            std::vector<Limbs> inv;
+        };
+
+        // powers up to the first one whose square is above every n limb value
+        inline const DecimalPowers& decimal_powers(size_t n)
+        {
+            thread_local DecimalPowers powers;
+            if( powers.pow.empty() )
+            {
+                powers.pow.push_back(Limbs(1, chunk_base));
+                powers.inv.push_back(inverse_exact(powers.pow.back(), 1));
+            }
+            while( 2 * (powers.pow.back().size() - 1) < n )
+            {
+                powers.pow.push_back(mul_v(powers.pow.back(), powers.pow.back()));
+                powers.inv.push_back(inverse_exact(powers.pow.back(), powers.pow.back().size()));
+            }
+            return powers;
+        }
+
+        // appends the decimal digits of a, left padded with zeros to pad digits when pad != 0
+        inline void to_decimal(Limbs a, size_t pad, const DecimalPowers& powers, std::string& out)
+        {
+            if( a.size() <= to_decimal_threshold )
+            {
+                std::string digits;
+                while( !is_zero(a) )
+                {
+                    // divrem_1 with the constant divisor spelled out, so the division compiles to a multiplication
+                    dlimb_t rem = 0;
+                    for( size_t i = a.size(); i-- > 0; )
+                    {
+                        const dlimb_t t = (rem << limb_bits) | a[i];
+                        a[i] = (limb_t)(t / chunk_base);
+                        rem = t % chunk_base;
+                    }
+                    limb_t chunk = rem;
+                    trim(a);
+                    for( int i = 0; i < chunk_digits; i++ )
+                    {
+                        digits.push_back('0' + chunk % 10);
+                        chunk /= 10;
+                    }
+                }
+                while( digits.size() > 1 && digits.back() == '0' ) digits.pop_back();
+                if( digits.empty() ) digits = "0";
+                if( pad > digits.size() ) out.append(pad - digits.size(), '0');
+                out.append(digits.rbegin(), digits.rend());
+                return;
+            }
+
+            // split at the largest power not above a, a < pow[k]^2 keeps the Barrett step exact
+            size_t k = 0;
+            while( k + 1 < powers.pow.size() && cmp(powers.pow[k + 1], a) <= 0 ) k++;
+            const size_t split_digits = (size_t)chunk_digits << k;
+
+            Limbs q, r;
+            divrem_barrett(q, r, a, powers.pow[k], powers.inv[k]);
+            to_decimal(q, pad > split_digits ? pad - split_digits : 0, powers, out);
+            to_decimal(r, split_digits, powers, out);
+        }
+
+        inline std::string to_decimal(const limb_t* a, size_t n)
+        {
+            if( n <= 2 ) return std::to_string(a[0] | (n > 1 ? (dlimb_t)a[1] << limb_bits : 0));
+
+            std::string out;
+            to_decimal(Limbs(a, a + n), 0, decimal_powers(n), out);
+            return out;
+        }
+    }
+
+    // limb storage with inline room for small values, spills to the heap once it grows past that
+    class LimbBuffer
+    {
+        typedef detail::limb_t limb_t;
+        public:
+            static constexpr size_t inline_capacity = 8;
+            // heap allocations made by all buffers of the current thread
+            static inline thread_local size_t heap_allocations = 0;
+
+            explicit LimbBuffer(size_t n = 0)
+            {
+                resize(n);
+            }
+
+            LimbBuffer(const LimbBuffer& other)
+            {
+                assign(other.data_, other.size_);
+            }
+
+            LimbBuffer& operator=(const LimbBuffer& other)
+            {
+                if( this != &other ) assign(other.data_, other.size_);
+                return *this;
+            }
+
+            LimbBuffer(LimbBuffer&& other) noexcept
+            {
+                take(other);
+            }
+
+            LimbBuffer& operator=(LimbBuffer&& other) noexcept
+            {
+                if( this != &other )
+                {
+                    if( data_ != local ) delete[] data_;
+                    data_ = local;
+                    capacity_ = inline_capacity;
+                    take(other);
+                }
+                return *this;
+            }
+
+            ~LimbBuffer()
+            {
+                if( data_ != local ) delete[] data_;
+            }
+
+            void assign(const limb_t* first, size_t n)
+            {
+                size_ = 0;
+                reserve(n);
+                std::copy(first, first + n, data_);
+                size_ = n;
+            }
+
+            // new limbs are zero
+            void resize(size_t n)
+            {
+                reserve(n);
+                if( n > size_ ) std::fill(data_ + size_, data_ + n, 0);
+                size_ = n;
+            }
+
+            void reserve(size_t n)
+            {
+                if( n <= capacity_ ) return;
+                const size_t new_capacity = std::max(n, 2 * capacity_);
+                limb_t* grown = new limb_t[new_capacity];
+                heap_allocations++;
+                std::copy(data_, data_ + size_, grown);
+                if( data_ != local ) delete[] data_;
+                data_ = grown;
+                capacity_ = new_capacity;
+            }
+
+            size_t size() const { return size_; }
+            size_t capacity() const { return capacity_; }
+            limb_t* data() { return data_; }
+            const limb_t* data() const { return data_; }
+            limb_t* begin() { return data_; }
+            const limb_t* begin() const { return data_; }
+            limb_t* end() { return data_ + size_; }
+            const limb_t* end() const { return data_ + size_; }
+            limb_t& operator[](size_t i) { return data_[i]; }
+            const limb_t& operator[](size_t i) const { return data_[i]; }
+
+        private:
+            // steals a heap block, inline limbs have to be copied
+            void take(LimbBuffer& other)
+            {
+                if( other.data_ == other.local )
+                {
+                    std::copy(other.local, other.local + other.size_, local);
+                }
+                else
+                {
+                    data_ = other.data_;
+                    capacity_ = other.capacity_;
+                    other.data_ = other.local;
+                    other.capacity_ = inline_capacity;
+                }
+                size_ = other.size_;
+                other.size_ = 0;
+            }
+
+            limb_t local[inline_capacity] = {};
+            limb_t* data_ = local;
+            size_t size_ = 0;
+            size_t capacity_ = inline_capacity;
+    };
+
     class BigInt
     {
-        static constexpr unsigned long long threshold = 1e6;
+        typedef detail::limb_t limb_t;
+        typedef detail::dlimb_t dlimb_t;
+
         public:
-            BigInt( unsigned long long n, int s_offset = -1, unsigned long long digit_count = 11000 )
-            : threshold_exp(get_threshold_exp())
-            , num(std::vector<unsigned long long>(digit_count / threshold_exp))
-            , digit_count(digit_count)
+            // s_offset reserves limbs below the value, storage only ever covers [0, end_offset)
+            BigInt( unsigned long long n, int s_offset = -1 )
+            : num(s_offset != -1 ? s_offset : 0)
             , start_offset(s_offset != -1 ? s_offset : 0)
             , end_offset(start_offset)
-            , start_threshold(threshold)
-            , effective_threshold(threshold)
             {
-                while( n / threshold > 0 )
-                {
-                    num[end_offset++] = n % threshold;
-                    n /= threshold;
-                }
-                num[end_offset++] = n;
+                const limb_t limbs[2] = {(limb_t)n, (limb_t)(n >> detail::limb_bits)};
+                assign_limbs(limbs, limbs[1] ? 2 : 1);
             }
 
-            BigInt operator*(unsigned long long factor)
+            BigInt operator*(unsigned long long factor) const &
             {
                 BigInt target = *this;
                 target.multiply_factor(factor);
                 return target;
             }
 
-            BigInt operator*(const BigInt& factor)
+            BigInt operator*(unsigned long long factor) &&
+            {
+                multiply_factor(factor);
+                return std::move(*this);
+            }
+
+            BigInt operator*(const BigInt& factor) const &
             {
                 BigInt target = *this;
                 target *= factor;
                 return target;
             }
 
+            BigInt operator*(const BigInt& factor) &&
+            {
+                *this *= factor;
+                return std::move(*this);
+            }
+
             void operator*=(const BigInt& factor)
             {
-                BigInt original = *this;
-                BigInt _this = BigInt(0, original.start_offset, original.digit_count);
-                for( int i = factor.start_offset; i < factor.end_offset; i++ )
-                {
-                    BigInt cache = original;
-                    cache.multiply_factor(factor.num[i], i - factor.start_offset);
-                    _this += cache;
-                }
-                *this = _this;
+                LimbBuffer r(limb_count() + factor.limb_count());
+                if( limb_count() >= factor.limb_count() ) detail::mul(r.data(), &num[start_offset], limb_count(), &factor.num[factor.start_offset], factor.limb_count());
+                else detail::mul(r.data(), &factor.num[factor.start_offset], factor.limb_count(), &num[start_offset], limb_count());
+                assign_limbs(r.data(), r.size());
             }
 
             void operator*=(unsigned long long factor)
@@ -58,29 +864,48 @@ namespace PositiveBigInt{
                 multiply_factor(factor);
             }
 
-            BigInt operator+(const BigInt& summand)
+            BigInt operator+(const BigInt& summand) const &
             {
                 BigInt target = *this;
                 target.add_big_int(summand);
                 return target;
             }
 
-            BigInt operator+(unsigned long long summand)
+            BigInt operator+(const BigInt& summand) &&
+            {
+                add_big_int(summand);
+                return std::move(*this);
+            }
+
+            BigInt operator+(BigInt&& summand) const &
+            {
+                summand.add_big_int(*this);
+                return std::move(summand);
+            }
+
+            BigInt operator+(BigInt&& summand) &&
+            {
+                add_big_int(summand);
+                return std::move(*this);
+            }
+
+            BigInt operator+(unsigned long long summand) const &
             {
                 BigInt target = *this;
-                target.effective_threshold = start_threshold;
-                unsigned long long keep = target.add_num_to_element_primitive(summand, start_offset);
-                finalize_keep(keep, start_offset+1);
-                target.effective_threshold = threshold;
+                target += summand;
                 return target;
             }
 
+            BigInt operator+(unsigned long long summand) &&
+            {
+                *this += summand;
+                return std::move(*this);
+            }
+
             void operator+=(const unsigned long long summand)
             {
-                effective_threshold = start_threshold;
-                unsigned long long keep = add_num_to_element_primitive(summand, start_offset);
-                effective_threshold = threshold;
-                finalize_keep(keep, start_offset+1);
+                const limb_t s[2] = {(limb_t)summand, (limb_t)(summand >> detail::limb_bits)};
+                add_limbs(s, s[1] ? 2 : 1);
             }
 
             void operator+=(const BigInt& summand)
@@ -88,125 +913,250 @@ namespace PositiveBigInt{
                 add_big_int(summand);
             }
 
-            BigInt operator-(const BigInt& substract)
+            BigInt operator-(const BigInt& substract) const &
             {
                 BigInt target = *this;
                 target.substract_big_int(substract);
                 return target;
             }
 
+            BigInt operator-(const BigInt& substract) &&
+            {
+                substract_big_int(substract);
+                return std::move(*this);
+            }
+
             void operator-=(const BigInt& substract)
             {
                 substract_big_int(substract);
             }
 
-            bool operator==(const BigInt& equal)
+            bool operator==(const BigInt& equal) const
+            {
+                return compare(equal) == 0;
+            }
+
+            bool operator!=(const BigInt& other) const
             {
-                return num == equal.num;
+                return compare(other) != 0;
             }
 
-            bool operator>(const BigInt& smaller)
+            bool operator>(const BigInt& smaller) const
             {
-                if( (end_offset - start_offset) != (smaller.end_offset - smaller.start_offset ) )
-                    return (end_offset - start_offset) > (smaller.end_offset - smaller.start_offset );
+                return compare(smaller) > 0;
+            }
 
-                const int offset_diff = start_offset - smaller.start_offset;
-                for( int i = end_offset - 1; i >= start_offset; i-- )
-                {
-                    const auto num_i = num[i];
-                    const auto smaller_num_i = smaller.num[i - offset_diff];
-                    if(num_i != smaller_num_i) return num_i > smaller_num_i;
-                }
-                return false;
+            bool operator>=(const BigInt& smaller_equal) const
+            {
+                return compare(smaller_equal) >= 0;
             }
 
-            bool operator>=(const BigInt& smaller_equal)
+            bool operator<(const BigInt& larger) const
             {
-                return *this == smaller_equal || *this > smaller_equal;
+                return compare(larger) < 0;
             }
 
-            bool operator<(const BigInt& larger)
+            bool operator<=(const BigInt& larger_equal) const
             {
-                return !(*this > larger) && !(*this == larger);
+                return compare(larger_equal) <= 0;
             }
 
-            BigInt get_big_int_until(size_t reverse_index, size_t new_digit_count = 250) const
+            // *this = (a + s) * m in a single pass, a may be *this
+            BigInt& add_mul_small(const BigInt& a, unsigned long long s, unsigned long long m)
             {
-                BigInt r(0, 0, new_digit_count);
-                int start_from = end_offset - 1 - reverse_index;
-                if( reverse_index >= end_offset - 1 - start_offset )
+                if( (s | m) >> detail::limb_bits )
                 {
-                    start_from = start_offset;
-                    r.start_threshold = start_threshold;
+                    if( &a != this ) *this = a;
+                    *this += s;
+                    multiply_factor(m);
+                    return *this;
                 }
-                r.end_offset = r.start_offset;
-                for(int i = start_from; i < end_offset; i++)
+
+                const size_t n = a.limb_count();
+                const int a_start = a.start_offset;
+                if( &a != this ) num.resize(start_offset + n + 2);
+                else reserve_limbs(start_offset + n + 2);
+                const limb_t* ap = &a.num[a_start];
+                limb_t* r = &num[start_offset];
+                dlimb_t add_keep = s;
+                dlimb_t mul_keep = 0;
+                for( size_t i = 0; i < n; i++ )
                 {
-                    r.num[i - start_from + r.start_offset] = num[i];
-                    r.end_offset++;
+                    const dlimb_t t = ap[i] + add_keep;
+                    add_keep = t >> detail::limb_bits;
+                    const dlimb_t p = (dlimb_t)(limb_t)t * m + mul_keep;
+                    r[i] = (limb_t)p;
+                    mul_keep = p >> detail::limb_bits;
                 }
-                return r;
+                const dlimb_t p = add_keep * m + mul_keep;
+                r[n] = (limb_t)p;
+                r[n + 1] = (limb_t)(p >> detail::limb_bits);
+                end_offset = start_offset + n + 2;
+                normalize();
+                return *this;
             }
 
-            unsigned long long modulo(unsigned long long m)
+            // *this = *this * m + s
+            BigInt& mul_add(unsigned long long m, unsigned long long s)
             {
-                unsigned long long res = 0;
-                res += num[start_offset] % m;
-                res %= m;
-                // std::cout << res << std::endl;
-                unsigned long long total_thres = threshold % m;
-                for( int i = start_offset + 1; i < end_offset; i++  )
+                if( (s | m) >> detail::limb_bits )
                 {
-                    // std::cout << total_thres << "*" << num[i] << std::endl;
-                    res += ((num[i] % m )*total_thres) % m;
-                    res %= m;
-                    // std::cout << res << std::endl;
-                    total_thres *= (threshold%m);
-                    total_thres %= m;
+                    multiply_factor(m);
+                    *this += s;
+                    return *this;
                 }
-                return res;
+
+                reserve_limbs(end_offset + 1);
+                dlimb_t keep = s;
+                for( int i = start_offset; i < end_offset; i++ )
+                {
+                    const dlimb_t t = (dlimb_t)num[i] * m + keep;
+                    num[i] = (limb_t)t;
+                    keep = t >> detail::limb_bits;
+                }
+                num[end_offset++] = (limb_t)keep;
+                normalize();
+                return *this;
             }
 
-            unsigned long long to_ull()
+            // *this += a * m
+            BigInt& addmul_1(const BigInt& a, unsigned long long m)
             {
-                if( (end_offset - start_offset)*threshold_exp > 20 ) std::cout << "warning, unsigned long long might be too small" << std::endl;
-                unsigned long long res = num[start_offset];
-                unsigned long long thres_total = threshold;
-                for( int i = start_offset + 1; i < end_offset; i++ )
+                if( m >> detail::limb_bits || &a == this )
                 {
-                    res += (thres_total*num[i]);
-                    thres_total *= threshold;
+                    add_big_int(a * m);
+                    return *this;
                 }
-                return res;
+
+                const size_t an = a.limb_count();
+                const size_t n = std::max(limb_count(), an) + 1;
+                reserve_limbs(start_offset + n + 1);
+                limb_t* r = &num[start_offset];
+                const limb_t keep = detail::addmul_1(r, &a.num[a.start_offset], an, (limb_t)m);
+                const limb_t carry[1] = {keep};
+                detail::add_into(r + an, n + 1 - an, carry, 1);
+                end_offset = start_offset + n + 1;
+                normalize();
+                return *this;
             }
 
-            int get_digit_sum(int until = 0)
+            // makes room for n value limbs without changing the value
+            void reserve(size_t n)
             {
-                int count_digits = 0;
-                int digit_sum = 0;
+                num.reserve(start_offset + n);
+            }
+
+            // floor(sqrt(*this) * 10^precision_digits)
+            BigInt isqrt(int precision_digits = 0) const
+            {
+                detail::Limbs n = get_limbs();
+                if( precision_digits > 0 ) n = detail::mul_v(n, detail::pow_small(10, 2 * precision_digits));
+                const detail::Limbs r = detail::isqrt(n);
+                return from_limbs(r.data(), r.size());
+            }
+
+            BigInt operator/(const BigInt& divisor) const
+            {
+                detail::Limbs q, r;
+                divrem(q, r, divisor);
+                return from_limbs(q.data(), q.size());
+            }
+
+            BigInt operator%(const BigInt& divisor) const
+            {
+                detail::Limbs q, r;
+                divrem(q, r, divisor);
+                return from_limbs(r.data(), r.size());
+            }
+
+            void operator/=(const BigInt& divisor)
+            {
+                *this = *this / divisor;
+            }
+
+            void operator%=(const BigInt& divisor)
+            {
+                *this = *this % divisor;
+            }
+
+            static BigInt from_limbs(const limb_t* limbs, size_t n)
+            {
+                BigInt r(0);
+                r.assign_limbs(limbs, n);
+                return r;
+            }
+
+            detail::Limbs get_limbs() const
+            {
+                return detail::Limbs(&num[start_offset], &num[start_offset] + limb_count());
+            }
+
+            // throws on a zero divisor
+            void divrem(detail::Limbs& q, detail::Limbs& r, const BigInt& divisor) const
+            {
+                const detail::Limbs b = divisor.get_limbs();
+                if( detail::is_zero(b) ) throw std::invalid_argument( "division by zero" );
+                detail::divrem(q, r, get_limbs(), b);
+            }
+
+            // the highest reverse_index + 1 limbs, i.e. the value shifted right by all lower limbs
+            BigInt get_big_int_until(size_t reverse_index) const
+            {
+                BigInt r(0, 0);
+                int start_from = end_offset - 1 - reverse_index;
+                if( reverse_index >= end_offset - 1 - start_offset ) start_from = start_offset;
+                r.assign_limbs(&num[start_from], end_offset - start_from);
+                return r;
+            }
+
+            unsigned long long modulo(unsigned long long m) const
+            {
+                unsigned __int128 res = 0;
                 for( int i = end_offset - 1; i >= start_offset; i-- )
                 {
-                    std::string s = std::to_string(num[i]);
-                    const auto effective_threshold_exp = (i == start_offset) ? get_threshold_exp(start_threshold) : threshold_exp;
-                    while( s.length() < effective_threshold_exp && i != end_offset - 1 ) s = "0" + s;
-                    for( int i = 0; i < s.length(); i++ )
+                    res = ((res << detail::limb_bits) | num[i]) % m;
+                }
+                return (unsigned long long)res;
+            }
+
+            unsigned long long to_ull() const
+            {
+                if( limb_count() > 2 ) std::cout << "warning, unsigned long long might be too small" << std::endl;
+                unsigned long long res = num[start_offset];
+                if( limb_count() > 1 ) res |= (unsigned long long)num[start_offset + 1] << detail::limb_bits;
+                return res;
+            }
+
+            // sum of the leading until digits, of all digits for until = 0; all but the leading until+1 digits
+            // of the lower bound on the digit count are divided off before the conversion
+            int get_digit_sum(int until = 0) const
+            {
+                detail::Limbs a = get_limbs();
+                if( until > 0 && limb_count() > 2 )
+                {
+                    const size_t bits = limb_count() * detail::limb_bits - detail::count_leading_zeros(num[end_offset - 1]);
+                    const long long digits = (long long)((bits - 1) * std::log10(2.0)) + 1;
+                    if( digits - 1 > until )
                     {
-                        if( until != 0 && count_digits >= until ) return digit_sum;
-                        count_digits++;
-                        digit_sum += s[i] - 48;
+                        detail::Limbs r;
+                        detail::divrem(a, r, get_limbs(), detail::pow_small(10, digits - 1 - until));
                     }
                 }
+                const std::string s = detail::to_decimal(a.data(), a.size());
+                int digit_sum = 0;
+                for( size_t i = 0; i < s.size() && (until == 0 || (int)i < until); i++ ) digit_sum += s[i] - '0';
                 return digit_sum;
             }
 
-            int get_digit_count()
+            int get_digit_count() const
             {
-                int count_digits = 0;
-                const int thres_exp = threshold_exp;
-                if( end_offset > start_offset + 1 ) count_digits = (threshold_exp * (end_offset - 2 - start_offset));
-                count_digits += std::to_string(num[end_offset - 1]).length();
-                if( end_offset > start_offset + 1 ) count_digits += get_threshold_exp(start_threshold);
-                return count_digits;
+                if( limb_count() <= 2 ) return std::to_string(to_ull()).length();
+
+                // 2^(bits-1) <= n < 2^bits leaves two candidates, decided by a single power of 10
+                const size_t bits = limb_count() * detail::limb_bits - detail::count_leading_zeros(num[end_offset - 1]);
+                const size_t digits = (size_t)((bits - 1) * std::log10(2.0)) + 1;
+                const detail::Limbs pow10 = detail::pow_small(10, digits);
+                return detail::cmp(&num[start_offset], limb_count(), pow10.data(), pow10.size()) >= 0 ? digits + 1 : digits;
             }
 
             friend std::ostream& operator<<(std::ostream& os, const BigInt& bi)
@@ -217,196 +1167,157 @@ namespace PositiveBigInt{
 
             std::string get_as_string() const
             {
-                std::stringstream os;
-                if( end_offset - start_offset >= 1 )
-                {
-                    os << num[end_offset - 1];
-                }
-
-                for( int i = end_offset - 2; i >= start_offset + 1; i-- ) os << std::setfill('0') << std::setw(threshold_exp) << num[i];
-                if( end_offset > start_offset + 1 ) os << std::setfill('0') << std::setw(get_threshold_exp(start_threshold)) << num[start_offset];
-                return os.str();
+                return detail::to_decimal(&num[start_offset], limb_count());
             }
 
-            unsigned long long threshold_exp;
-            std::vector<unsigned long long> num;
-            size_t digit_count;
+            LimbBuffer num;
             int start_offset;
             int end_offset;
-            unsigned long long start_threshold;
-            unsigned long long effective_threshold;
 
-            unsigned long long get_threshold_exp(const unsigned long long thres = threshold) const
+            size_t limb_count() const
             {
-                unsigned long long threshold_exp = 1;
-                unsigned long long threshold_cache = thres;
-                while( (unsigned long long)threshold_cache / (unsigned long long)10 > 1 )
-                {
-                    threshold_exp++;
-                    threshold_cache /= (unsigned long long)10;
-                }
-                return threshold_exp;
+                return end_offset - start_offset;
             }
 
             void multiply_by_10()
             {
-                if( start_threshold == threshold )
+                multiply_factor(10);
+            }
+
+            private:
+                int compare(const BigInt& other) const
                 {
-                    start_offset--;
-                    start_threshold = 10;
-                    num[start_offset] = 0;
-                    return;
+                    return detail::cmp(&num[start_offset], limb_count(), &other.num[other.start_offset], other.limb_count());
                 }
-                else
+
+                void reserve_limbs(size_t n)
                 {
-                    start_threshold *= 10;
-                    num[start_offset] *= 10;
-                    num[start_offset] %= start_threshold;
+                    if( num.size() < n ) num.resize(n);
                 }
-            }
 
-            private:
-                unsigned long long add_num_to_element_primitive(const unsigned long long& n, const int index)
+                // leading zero limbs of r are dropped
+                void assign_limbs(const limb_t* r, size_t n)
                 {
-                    unsigned long long& numi = num[index];
-                    numi += n;
-                    const unsigned long long res = numi / effective_threshold;
-                    numi %= effective_threshold;
-                    return res;
+                    while( n > 1 && r[n - 1] == 0 ) n--;
+                    num.resize(start_offset + n);
+                    std::copy(r, r + n, num.begin() + start_offset);
+                    end_offset = start_offset + n;
                 }
 
-                void finalize_keep(unsigned long long& keep, int start_from)
+                void normalize()
                 {
-                    while( keep != 0 )
-                    {
-                        keep = add_num_to_element_primitive(keep, start_from);
-                        if( start_from++ >= end_offset ) end_offset++;
-                    }
+                    while( end_offset - start_offset > 1 && num[end_offset - 1] == 0 ) end_offset--;
+                    num.resize(end_offset);
+                }
+
+                void add_limbs(const limb_t* b, size_t bn)
+                {
+                    const size_t n = std::max(limb_count(), bn);
+                    reserve_limbs(start_offset + n + 1);
+                    std::fill(num.begin() + end_offset, num.begin() + start_offset + n + 1, 0);
+                    detail::add_into(&num[start_offset], n + 1, b, bn);
+                    end_offset = start_offset + n + 1;
+                    normalize();
                 }
 
                 void add_big_int(const BigInt& bb)
                 {
-                    auto& a = num;
-                    const auto& b = bb.num;
-                    const int b_size = bb.end_offset;
-                    unsigned long long keep = 0;
-                    for( int i = bb.start_offset; i < b_size; i++ )
+                    if( &bb == this )
                     {
-                        const int aind = i + start_offset - bb.start_offset;
-                        const unsigned long long bi = b[i];
-                        keep = add_num_to_element_primitive(bi + keep, aind);
-                        if( aind >= end_offset )
-                        {
-                            end_offset++;
-                        }
+                        multiply_factor(2);
+                        return;
                     }
-                    finalize_keep(keep, b_size + start_offset - bb.start_offset);
+                    add_limbs(&bb.num[bb.start_offset], bb.limb_count());
                 }
 
                 void substract_big_int(const BigInt& bb)
                 {
-                    auto& a = num;
-                    const auto& b = bb.num;
-                    const int b_size = bb.end_offset;
-                    uint8_t keep = 0;
-                    const int start_offset_diff = start_offset - bb.start_offset;
-                    unsigned long long *ai = &a[start_offset];
-                    if( start_threshold <= bb.start_threshold )
-                    {
-                        const unsigned long long thres_keep_factor = (threshold / bb.start_threshold) * start_threshold;
-                        unsigned long long keep_start_thres_delay = b[bb.start_offset] / start_threshold;
-                        const unsigned long long thres_factor = (threshold / thres_keep_factor);
-                        *ai += start_threshold - (b[bb.start_offset] % start_threshold);
-                        keep = *ai < start_threshold ? 1 : 0;
-                        *ai %= start_threshold;
-                        for( int i = bb.start_offset + 1; i < b_size; i++ )
-                        {
-                            ai = &a[i + start_offset_diff];
-                            const unsigned long long& bi = b[i];
-                            unsigned long long effective_bi = bi % thres_keep_factor;
-                            effective_bi *= thres_factor;
-                            effective_bi += keep_start_thres_delay;
-                            keep_start_thres_delay = bi / thres_keep_factor;
-                            *ai += threshold - effective_bi - keep;
-                            keep = *ai < threshold ? 1 : 0;
-                            *ai %= threshold;
-                        }
-                        ai = &a[b_size + start_offset_diff];
-                        *ai += threshold;
-                        *ai -= (keep_start_thres_delay + keep);
-                        keep = *ai < threshold ? 1 : 0;
-                        *ai %= threshold;
-                        ai++;
-                    }
-                    else
-                    {
-                        const unsigned long long thres_div = start_threshold / bb.start_threshold;
-                        unsigned long long effective_bi = b[bb.start_offset];
-                        const int bb_offset_diff = bb.end_offset - bb.start_offset;
-
-                        if( bb_offset_diff > 1 ) effective_bi += ((b[bb.start_offset + 1] % thres_div) * bb.start_threshold);
-                        *ai += start_threshold - effective_bi;
-                        keep = *ai < start_threshold ? 1 : 0;
-                        *ai %= start_threshold;
-                        for( int i = bb.start_offset + 1; i < b_size; i++ )
-                        {
-                            ai = &a[i + start_offset_diff];
-                            effective_bi = b[i] / thres_div;
-                            if( i < bb.end_offset - 1 ) effective_bi += ((b[i + 1] % thres_div) * (threshold / thres_div));
-                            *ai += threshold - ( effective_bi + keep);
-                            keep = *ai < threshold ? 1 : 0;
-                            *ai %= threshold;
-                        }
-                    }
-                    while( keep == 1 )
-                    {
-                        *ai += threshold - 1;
-                        keep = *ai < threshold ? 1 : 0;
-                        *ai %= threshold;
-                    }
-                    while( a[end_offset - 1] == 0 && end_offset - start_offset > 1 ) end_offset--;
+                    if( compare(bb) < 0 ) throw std::invalid_argument( "received negative value" );
+                    detail::sub(&num[start_offset], &num[start_offset], limb_count(), &bb.num[bb.start_offset], bb.limb_count());
+                    normalize();
                 }
 
-                void multiply_factor(const unsigned long long& factor, const int offset = 0)
+                void multiply_factor(const unsigned long long& factor)
                 {
-                    auto& a = num;
-                    if( factor == 0 )
+                    if( factor >> detail::limb_bits )
                     {
-                        end_offset = start_offset;
-                        a[end_offset++] = 0;
+                        *this *= BigInt(factor, 0);
                         return;
                     }
+                    reserve_limbs(end_offset + 1);
+                    num[end_offset] = detail::mul_1(&num[start_offset], &num[start_offset], limb_count(), (limb_t)factor);
+                    end_offset++;
+                    normalize();
+                }
+    };
 
-                    if( factor == 1 && offset == 0 ) return;
+    // quotient and remainder
+    std::pair<BigInt, BigInt> divmod(const BigInt& a, const BigInt& b)
+    {
+        detail::Limbs q, r;
+        a.divrem(q, r, b);
+        return {BigInt::from_limbs(q.data(), q.size()), BigInt::from_limbs(r.data(), r.size())};
+    }
 
-                    if( offset != 0 )
-                    {
-                        BigInt cache(0, this->start_offset, this->digit_count);
-                        cache.end_offset = offset + end_offset;
-                        cache.start_offset = start_offset;
-                        unsigned long long keep = 0;
-                        for( int i = start_offset; i < end_offset; i++ )
-                        {
-                            const unsigned long c = (num[i] * factor) + keep;
-                            keep = cache.add_num_to_element_primitive( c, i + offset);
-                        }
-                        cache.finalize_keep( keep, cache.end_offset);
-                        *this = cache;
-                    }
-                    else
-                    {
-                        unsigned long long keep = 0;
-                        effective_threshold = start_threshold;
-                        keep = add_num_to_element_primitive( num[start_offset]*(factor-1), start_offset);
-                        effective_threshold = threshold;
-                        for( int i = start_offset + 1; i < end_offset; i++ )
-                        {
-                            const unsigned long long c = (num[i] * (factor - 1)) + keep;
-                            keep = add_num_to_element_primitive( c, i + offset);
-                        }
-                        finalize_keep( keep, end_offset);
-                    }
+    // Barrett reduction for repeated division by the same value, the reciprocal is computed once
+    class PrecomputedDivisor
+    {
+        public:
+            PrecomputedDivisor(const BigInt& divisor)
+            : d(divisor.get_limbs())
+            {
+                if( detail::is_zero(d) ) throw std::invalid_argument( "division by zero" );
+                inv = detail::inverse_exact(d, d.size());
+            }
+
+            BigInt mod(const BigInt& a) const
+            {
+                const detail::Limbs r = reduce(a.get_limbs());
+                return BigInt::from_limbs(r.data(), r.size());
+            }
+
+            std::pair<BigInt, BigInt> divmod(const BigInt& a) const
+            {
+                const detail::Limbs r = reduce(a.get_limbs());
+                const BigInt rem = BigInt::from_limbs(r.data(), r.size());
+                // (a - r) / d is exact, it only needs the high half of a Barrett quotient
+                detail::Limbs q, unused;
+                detail::divrem(q, unused, detail::sub_v(a.get_limbs(), r), d);
+                return {BigInt::from_limbs(q.data(), q.size()), rem};
+            }
+
+        private:
+            // a % d for a < B^(2m)
+            detail::Limbs reduce_block(const detail::Limbs& a) const
+            {
+                if( detail::cmp(a, d) < 0 ) return a;
+                detail::Limbs q, r;
+                detail::divrem_barrett(q, r, a, d, inv);
+                return r;
+            }
+
+            // longer inputs are folded in from the top, m limbs at a time
+            detail::Limbs reduce(const detail::Limbs& a) const
+            {
+                const size_t m = d.size();
+                if( a.size() <= 2 * m ) return reduce_block(a);
+                size_t pos = a.size() - std::min(a.size(), 2 * m);
+                detail::Limbs r = reduce_block(detail::Limbs(a.begin() + pos, a.end()));
+                while( pos > 0 )
+                {
+                    const size_t n = std::min(m, pos);
+                    pos -= n;
+                    detail::Limbs block = detail::shifted(r, n);
+                    block.resize(std::max(block.size(), n));
+                    std::copy(a.begin() + pos, a.begin() + pos + n, block.begin());
+                    detail::trim(block);
+                    r = reduce_block(block);
                 }
+                return r;
+            }
+
+            detail::Limbs d;
+            detail::Limbs inv;
     };
 
     void unit_test(BigInt a, const std::string& expected )
@@ -582,6 +1493,10 @@ namespace PositiveBigInt{
             s_perf.push_back( random + 48 );
         }
         unit_test( perf, s_perf );
+        int prefix_sum = 0;
+        for( int i = 0; i < 500; i++ ) prefix_sum += s_perf[i] - 48;
+        unit_test_operator( perf.get_digit_sum(500) == prefix_sum );
+        unit_test_operator( (perf * perf).get_digit_sum(1) == (perf * perf).get_as_string()[0] - 48 );
 
         // start_threshold test
         BigInt start_thres = BigInt(1, 5);
@@ -735,10 +1650,204 @@ namespace PositiveBigInt{
         BigInt fac(12);
         fac *= fac;
         unit_test(fac, "144");
+
+        BigInt fused(999);
+        fused.add_mul_small(fused, 1, 1000);
+        unit_test(fused, "1000000");
+        fused.mul_add(10, 7);
+        unit_test(fused, "10000007");
+        fused.addmul_1(BigInt(3), 5);
+        unit_test(fused, "10000022");
+        fused.add_mul_small(BigInt(4294967295), 1, 4294967295);
+        unit_test(fused, "18446744069414584320");
+        unit_test(BigInt(5) + BigInt(7) * 3, "26");
+        unit_test_operator( BigInt(7) <= BigInt(7) && BigInt(7) != BigInt(8) );
+
+        auto qr = divmod(BigInt(1000000007) * BigInt(998244353) + 5, BigInt(998244353));
+        unit_test(qr.first, "1000000007");
+        unit_test(qr.second, "5");
+        unit_test(BigInt(12345678901234567) % BigInt(1000), "567");
+        unit_test(BigInt(12345678901234567) / BigInt(1000), "12345678901234");
+        BigInt nines(1), split(1);
+        for( int i = 0; i < 200; i++ ) nines *= 10;
+        for( int i = 0; i < 100; i++ ) split *= 10;
+        nines -= BigInt(1);
+        split += 1;
+        qr = divmod(nines, split);
+        unit_test(qr.first, std::string(100, '9'));
+        unit_test(qr.second, "0");
+        unit_test(PrecomputedDivisor(split).mod(nines + 12), "12");
+        unit_test(PrecomputedDivisor(BigInt(998244353)).mod(nines), (nines % BigInt(998244353)).get_as_string());
+        unit_test(BigInt(2).isqrt(30), "1414213562373095048801688724209");
+        unit_test(BigInt(99980001).isqrt(), "9999");
+        unit_test(BigInt(99980000).isqrt(), "9998");
+        unit_test(nines.isqrt(), std::string(100, '9'));
+        unit_test((nines + 1).isqrt(), "1" + std::string(100, '0'));
+        bool thrown = false;
+        try { nines / BigInt(0); } catch( const std::invalid_argument& ) { thrown = true; }
+        unit_test_operator(thrown);
         BigInt f_(100021313);
         f_ *= 1.5e12;
         unit_test( f_, "15003196950000000000" );
         f_ *= 1.5e12;
         unit_test( f_, "2250479542500000000000000000000000");
    }
-}
\ No newline at end of file
+
+    // times one top level step of every algorithm on random n limb factors, the crossovers are
+    // where Karatsuba beats the basecase and Toom-3 beats Karatsuba
+    void benchmark_multiplication()
+    {
+        using namespace std::chrono;
+        typedef void (*mul_fn)(detail::limb_t*, const detail::limb_t*, size_t, const detail::limb_t*, size_t);
+        const mul_fn algorithms[3] = {detail::mul_basecase, detail::mul_karatsuba, detail::mul_toom3};
+
+        srand(1);
+        std::cout << std::setw(8) << "limbs" << std::setw(14) << "basecase" << std::setw(14) << "karatsuba" << std::setw(14) << "toom3" << std::endl;
+        for( size_t n = 8; n <= 4096; n *= 2 )
+        {
+            for( const size_t size : {n, n + n / 2} )
+            {
+                detail::Limbs a(size), b(size), r(2 * size);
+                for( size_t i = 0; i < size; i++ )
+                {
+                    a[i] = rand();
+                    b[i] = rand();
+                }
+                const int reps = std::max<int>(1, 2000000 / (size * size));
+                std::cout << std::setw(8) << size;
+                for( const auto& algorithm : algorithms )
+                {
+                    auto start = high_resolution_clock::now();
+                    for( int i = 0; i < reps; i++ ) algorithm(r.data(), a.data(), size, b.data(), size);
+                    auto stop = high_resolution_clock::now();
+                    std::cout << std::setw(12) << duration_cast<nanoseconds>(stop - start).count() / reps << "ns";
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    // ns per operation on numbers of the given decimal size, only uses the public interface; base 1e6 is
+    // how the former decimal limb layout printed the same product, one zero padded limb after the other
+    void benchmark_throughput()
+    {
+        using namespace std::chrono;
+        srand(1);
+        std::cout << std::setw(8) << "digits" << std::setw(14) << "add" << std::setw(14) << "mul_small" << std::setw(14) << "mul" << std::setw(14) << "to_string" << std::setw(14) << "base 1e6" << std::endl;
+        for( const int digits : {100, 1000, 10000} )
+        {
+            BigInt a(1), b(1);
+            for( int i = 0; i < digits / 6; i++ )
+            {
+                a *= 1000000;
+                a += rand() % 1000000;
+                b *= 1000000;
+                b += rand() % 1000000;
+            }
+            const int reps = std::max(10, 20000000 / (digits * digits));
+
+            BigInt sum = a;
+            auto start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ ) sum += b;
+            const auto add_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps;
+
+            BigInt prod = a;
+            start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ ) prod *= 7;
+            const auto mul_small_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps;
+
+            start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ )
+            {
+                prod = a;
+                prod *= b;
+            }
+            const auto mul_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps;
+
+            // the first conversion of a size builds the cached powers and their reciprocals
+            const std::string printed = prod.get_as_string();
+            size_t length = 0;
+            start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ ) length += prod.get_as_string().length();
+            const auto to_string_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps;
+
+            std::vector<unsigned long long> decimal_limbs;
+            for( size_t end = printed.size(); end > 0; end -= std::min<size_t>(end, 6) )
+            {
+                decimal_limbs.push_back(std::stoull(printed.substr(end - std::min<size_t>(end, 6), std::min<size_t>(end, 6))));
+            }
+            start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ )
+            {
+                std::stringstream os;
+                os << decimal_limbs.back();
+                for( size_t j = decimal_limbs.size() - 1; j-- > 0; ) os << std::setfill('0') << std::setw(6) << decimal_limbs[j];
+                length += os.str().length();
+            }
+            const auto base_1e6_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps;
+
+            std::cout << std::setw(8) << digits << std::setw(12) << add_ns << "ns" << std::setw(12) << mul_small_ns << "ns";
+            std::cout << std::setw(12) << mul_ns << "ns" << std::setw(12) << to_string_ns << "ns" << std::setw(12) << base_1e6_ns << "ns" << std::endl;
+        }
+    }
+
+    // heap allocations and time of the unit_tests() workload and of a 128 bit mulmod through BigInt
+    void benchmark_allocations()
+    {
+        using namespace std::chrono;
+        std::stringstream sink;
+        auto* cout_buf = std::cout.rdbuf(sink.rdbuf());
+        const int runs = 20;
+        size_t allocations = LimbBuffer::heap_allocations;
+        auto start = high_resolution_clock::now();
+        for( int i = 0; i < runs; i++ ) unit_tests();
+        const auto unit_tests_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / runs;
+        const size_t unit_tests_allocations = (LimbBuffer::heap_allocations - allocations) / runs;
+        std::cout.rdbuf(cout_buf);
+        std::cout << "unit_tests: " << unit_tests_ns << "ns/run, " << unit_tests_allocations << " allocations/run" << std::endl;
+
+        const int reps = 1000000;
+        unsigned long long res = 0;
+        allocations = LimbBuffer::heap_allocations;
+        start = high_resolution_clock::now();
+        for( int i = 0; i < reps; i++ )
+        {
+            BigInt b_res(7000000000000ull + i);
+            b_res *= (6000000000000ull + res);
+            res = b_res.modulo(7290000000001ull);
+        }
+        const auto mulmod_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps;
+        std::cout << "mulmod: " << mulmod_ns << "ns/op, " << (LimbBuffer::heap_allocations - allocations) << " allocations in " << reps << " ops (" << res << ")" << std::endl;
+    }
+
+    // 2n by n limb division, Knuth's algorithm D against the Newton reciprocal, and a Barrett reduction with a precomputed divisor
+    void benchmark_division()
+    {
+        using namespace std::chrono;
+        srand(1);
+        std::cout << std::setw(8) << "limbs" << std::setw(14) << "knuth" << std::setw(14) << "newton" << std::setw(14) << "barrett" << std::endl;
+        for( size_t n = 16; n <= 4096; n *= 2 )
+        {
+            detail::Limbs a(2 * n), b(n), q, r;
+            for( auto& ai : a ) ai = rand();
+            for( auto& bi : b ) bi = rand();
+            b[n - 1] |= 1;
+            const int reps = std::max<int>(1, 4000000 / (n * n));
+            std::cout << std::setw(8) << n;
+
+            auto start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ ) detail::divrem_small(q, r, a, b);
+            std::cout << std::setw(12) << duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps << "ns";
+
+            start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ ) detail::divrem_newton(q, r, a, b);
+            std::cout << std::setw(12) << duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps << "ns";
+
+            const PrecomputedDivisor divisor(BigInt::from_limbs(b.data(), b.size()));
+            const BigInt big_a = BigInt::from_limbs(a.data(), a.size());
+            start = high_resolution_clock::now();
+            for( int i = 0; i < reps; i++ ) divisor.mod(big_a);
+            std::cout << std::setw(12) << duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / reps << "ns" << std::endl;
+        }
+    }
+}
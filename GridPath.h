@@ -0,0 +1,463 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <string>
+#include <memory>
+#include <utility>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "TextIO.h"
+
+// the cells a path may step to from cell, one move set per problem
+namespace GridMoves{
+    // euler81, right and down
+    struct RightDown
+    {
+        template<typename Visit>
+        static void for_each(uint32_t cell, size_t rows, size_t cols, Visit visit)
+        {
+            const size_t r = cell / cols;
+            const size_t c = cell - r * cols;
+            if( c + 1 < cols ) visit(cell + 1);
+            if( r + 1 < rows ) visit(cell + cols);
+        }
+    };
+
+    // euler82, up, down and right
+    struct UpDownRight
+    {
+        template<typename Visit>
+        static void for_each(uint32_t cell, size_t rows, size_t cols, Visit visit)
+        {
+            const size_t r = cell / cols;
+            const size_t c = cell - r * cols;
+            if( r + 1 < rows ) visit(cell + cols);
+            if( r > 0 ) visit(cell - cols);
+            if( c + 1 < cols ) visit(cell + 1);
+        }
+    };
+
+    // euler83, all four neighbours
+    struct FourWay
+    {
+        template<typename Visit>
+        static void for_each(uint32_t cell, size_t rows, size_t cols, Visit visit)
+        {
+            const size_t r = cell / cols;
+            const size_t c = cell - r * cols;
+            if( r + 1 < rows ) visit(cell + cols);
+            if( r > 0 ) visit(cell - cols);
+            if( c > 0 ) visit(cell - 1);
+            if( c + 1 < cols ) visit(cell + 1);
+        }
+    };
+}
+
+// cheapest paths through a row major grid of non negative cell costs, a path costs the sum of all its cells
+// including both ends and steps as Moves allows
+// the buffers are sized once per attached grid and every query only touches the cells it reaches,
+// a distance counts only if its epoch stamp is the current one, so a new query starts by bumping the epoch
+template<typename Cost, typename Dist = uint64_t, typename Moves = GridMoves::FourWay>
+class GridShortestPath
+{
+public:
+    static constexpr Dist unreached = std::numeric_limits<Dist>::max();
+    // Dial's ring holds one bucket per possible cost, above this the 4-ary heap is used instead
+    static constexpr uint64_t max_bucket_cost = 1 << 16;
+
+    GridShortestPath() = default;
+
+    GridShortestPath(const Cost* values, size_t rows, size_t cols)
+    {
+        attach(values, rows, cols);
+    }
+
+    // the grid has to outlive the queries on it
+    void attach(const Cost* values_, size_t rows_, size_t cols_)
+    {
+        values = values_;
+        rows = rows_;
+        cols = cols_;
+        largest = 0;
+        for( size_t i = 0; i < rows * cols; i++ ) largest = std::max<uint64_t>(largest, values[i]);
+        state.assign(rows * cols, State{});
+        wanted.assign(rows * cols, 0);
+        epoch = 0;
+    }
+
+    Dist solve(const Cost* values_, size_t rows_, size_t cols_, size_t source, size_t target)
+    {
+        attach(values_, rows_, cols_);
+        return query(source, target);
+    }
+
+    Dist query(size_t source, size_t target)
+    {
+        Dist d;
+        query(source, &target, 1, &d);
+        return d;
+    }
+
+    // distances from source to every target, one search that stops once the last target is settled
+    void query(size_t source, const size_t* targets, size_t count, Dist* out)
+    {
+        const size_t remaining = start(targets, count);
+        if( largest <= max_bucket_cost ) dial(source, remaining);
+        else heap(source, remaining);
+        for( size_t i = 0; i < count; i++ ) out[i] = distance(targets[i]);
+    }
+
+    // the same answer from the heap whatever the costs are
+    Dist query_heap(size_t source, size_t target)
+    {
+        heap(source, start(&target, 1));
+        return distance(target);
+    }
+
+    // answers every (source, target) pair, pairs sharing a source share one search
+    std::vector<Dist> queries(const std::vector<std::pair<size_t, size_t>>& pairs)
+    {
+        std::vector<uint32_t> order(pairs.size());
+        for( size_t i = 0; i < order.size(); i++ ) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return pairs[a].first < pairs[b].first; });
+
+        std::vector<Dist> res(pairs.size());
+        std::vector<size_t> targets;
+        std::vector<Dist> found;
+        for( size_t i = 0; i < order.size(); )
+        {
+            const size_t source = pairs[order[i]].first;
+            size_t j = i;
+            targets.clear();
+            while( j < order.size() && pairs[order[j]].first == source ) targets.push_back(pairs[order[j++]].second);
+            found.resize(targets.size());
+            query(source, targets.data(), targets.size(), found.data());
+            for( size_t k = 0; k < targets.size(); k++ ) res[order[i + k]] = found[k];
+            i = j;
+        }
+        return res;
+    }
+
+    // distance of cell in the last query, exact for cells settled before the search stopped
+    Dist distance(size_t cell) const
+    {
+        return state[cell].epoch == epoch ? state[cell].dist : unreached;
+    }
+
+private:
+    // a distance and the epoch it belongs to, side by side so a relaxation reads one line
+    struct State
+    {
+        Dist dist = unreached;
+        uint32_t epoch = 0;
+    };
+
+    // new epoch with the targets marked, returns the number of distinct targets
+    size_t start(const size_t* targets, size_t count)
+    {
+        if( ++epoch == 0 )
+        {
+            // after 2^32 queries the old stamps could collide with new ones
+            for( auto& s: state ) s = State{};
+            std::fill(wanted.begin(), wanted.end(), 0);
+            epoch = 1;
+        }
+        size_t distinct = 0;
+        for( size_t i = 0; i < count; i++ )
+        {
+            if( wanted[targets[i]] == epoch ) continue;
+            wanted[targets[i]] = epoch;
+            distinct++;
+        }
+        return distinct;
+    }
+
+    void set(uint32_t cell, Dist d)
+    {
+        state[cell].dist = d;
+        state[cell].epoch = epoch;
+    }
+
+    // bucket queue over distances modulo largest + 1, every queued distance lies within largest of the current one
+    // a cell is pushed again when its distance drops and the stale entry is skipped when popped,
+    // the buckets keep their capacity between queries; only a search that stops early leaves entries behind,
+    // so the buckets filled since the last query are the only ones cleared
+    void dial(size_t source, size_t remaining)
+    {
+        if( remaining == 0 ) return;
+        const size_t ring = largest + 1;
+        buckets.resize(std::max(buckets.size(), ring));
+        for( const uint32_t filled: filled_buckets ) buckets[filled].clear();
+        filled_buckets.clear();
+        auto push = [&](size_t b, uint32_t cell)
+        {
+            if( buckets[b].empty() ) filled_buckets.push_back(b);
+            buckets[b].push_back(cell);
+        };
+
+        set(source, values[source]);
+        push(distance(source) % ring, source);
+        size_t queued = 1;
+        Dist current = distance(source);
+        size_t b = current % ring;
+        while( queued > 0 )
+        {
+            while( buckets[b].empty() )
+            {
+                current++;
+                b = b + 1 == ring ? 0 : b + 1;
+            }
+            // zero cost cells land in the bucket being drained, so it is drained from the back until empty
+            auto& bucket = buckets[b];
+            while( !bucket.empty() )
+            {
+                const uint32_t u = bucket.back();
+                bucket.pop_back();
+                queued--;
+                if( distance(u) != current ) continue;
+                if( wanted[u] == epoch && --remaining == 0 ) return;
+                Moves::for_each(u, rows, cols, [&](uint32_t v)
+                {
+                    const Dist d = current + values[v];
+                    if( d >= distance(v) ) return;
+                    set(v, d);
+                    push(d % ring, v);
+                    queued++;
+                });
+            }
+        }
+    }
+
+    // 4-ary heap with decrease key for arbitrary costs
+    void heap(size_t source, size_t remaining)
+    {
+        if( remaining == 0 ) return;
+        slot.resize(rows * cols);
+        heap_cells.clear();
+        auto sift_up = [&](size_t i)
+        {
+            const uint32_t cell = heap_cells[i];
+            while( i > 0 && distance(heap_cells[(i - 1) / 4]) > distance(cell) )
+            {
+                heap_cells[i] = heap_cells[(i - 1) / 4];
+                slot[heap_cells[i]] = i;
+                i = (i - 1) / 4;
+            }
+            heap_cells[i] = cell;
+            slot[cell] = i;
+        };
+        auto sift_down = [&](size_t i)
+        {
+            const uint32_t cell = heap_cells[i];
+            while( true )
+            {
+                const size_t first = 4 * i + 1;
+                if( first >= heap_cells.size() ) break;
+                size_t best = first;
+                const size_t last = std::min(first + 4, heap_cells.size());
+                for( size_t c = first + 1; c < last; c++ )
+                {
+                    if( distance(heap_cells[c]) < distance(heap_cells[best]) ) best = c;
+                }
+                if( distance(heap_cells[best]) >= distance(cell) ) break;
+                heap_cells[i] = heap_cells[best];
+                slot[heap_cells[i]] = i;
+                i = best;
+            }
+            heap_cells[i] = cell;
+            slot[cell] = i;
+        };
+
+        set(source, values[source]);
+        heap_cells.push_back(source);
+        slot[source] = 0;
+        while( !heap_cells.empty() )
+        {
+            const uint32_t u = heap_cells[0];
+            heap_cells[0] = heap_cells.back();
+            heap_cells.pop_back();
+            if( !heap_cells.empty() ) sift_down(0);
+            if( wanted[u] == epoch && --remaining == 0 ) return;
+            Moves::for_each(u, rows, cols, [&](uint32_t v)
+            {
+                const Dist d = distance(u) + values[v];
+                if( d >= distance(v) ) return;
+                const bool queued = distance(v) != unreached;
+                set(v, d);
+                if( !queued )
+                {
+                    heap_cells.push_back(v);
+                    slot[v] = heap_cells.size() - 1;
+                }
+                sift_up(slot[v]);
+            });
+        }
+    }
+
+    const Cost* values = nullptr;
+    size_t rows = 0;
+    size_t cols = 0;
+    uint64_t largest = 0;
+    std::vector<State> state;
+    // epoch in which a cell was asked for as a target
+    std::vector<uint32_t> wanted;
+    uint32_t epoch = 0;
+    std::vector<std::vector<uint32_t>> buckets;
+    // buckets that went from empty to filled during the last Dial search
+    std::vector<uint32_t> filled_buckets;
+    // heap of queued cells and the heap slot of every queued cell
+    std::vector<uint32_t> heap_cells;
+    std::vector<uint32_t> slot;
+};
+
+// row major grid of cell costs in one contiguous buffer
+template<typename Cost>
+struct Grid
+{
+    size_t rows = 0;
+    size_t cols = 0;
+    std::vector<Cost> cells;
+};
+
+namespace GridLoad{
+    // text of a file mapped into memory, or of stdin read in one go; hold keeps either alive and
+    // stays empty for text owned by the caller
+    struct Text
+    {
+        Text() = default;
+        Text(const char* data, size_t size, std::shared_ptr<void> hold = nullptr) : data(data), size(size), hold(std::move(hold)) {}
+
+        const char* data = nullptr;
+        size_t size = 0;
+        std::shared_ptr<void> hold;
+    };
+
+    // path "-" reads stdin
+    inline bool read_text(const std::string& path, Text& text)
+    {
+        if( path == "-" )
+        {
+            auto buffer = std::make_shared<std::vector<char>>(TextIO::read_all(stdin));
+            text = Text(buffer->data(), buffer->size(), buffer);
+            return true;
+        }
+
+        const int fd = open(path.c_str(), O_RDONLY);
+        if( fd < 0 ) return false;
+        struct stat st;
+        if( fstat(fd, &st) != 0 )
+        {
+            close(fd);
+            return false;
+        }
+        const size_t bytes = st.st_size;
+        text.size = bytes;
+        if( bytes == 0 )
+        {
+            close(fd);
+            return true;
+        }
+        void* base = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if( base == MAP_FAILED ) return false;
+        madvise(base, bytes, MADV_SEQUENTIAL);
+        text.data = static_cast<const char*>(base);
+        text.hold = std::shared_ptr<void>(base, [bytes](void* p){ munmap(p, bytes); });
+        return true;
+    }
+
+    inline bool is_separator(char c)
+    {
+        return c == ',' || c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // shape and largest value of a matrix with one row per line and comma or blank separated values,
+    // false for ragged rows, an empty matrix or any other character
+    inline bool scan(const char* p, size_t n, size_t& rows, size_t& cols, uint64_t& largest)
+    {
+        rows = 0;
+        cols = 0;
+        largest = 0;
+        size_t count = 0;
+        uint64_t value = 0;
+        bool in_number = false;
+        for( size_t i = 0; i <= n; i++ )
+        {
+            const char c = i < n ? p[i] : '\n';
+            if( c >= '0' && c <= '9' )
+            {
+                value = value * 10 + (c - '0');
+                in_number = true;
+                continue;
+            }
+            if( c != '\n' && !is_separator(c) ) return false;
+            if( in_number )
+            {
+                largest = std::max(largest, value);
+                count++;
+                value = 0;
+                in_number = false;
+            }
+            if( c == '\n' && count > 0 )
+            {
+                if( rows == 0 ) cols = count;
+                else if( count != cols ) return false;
+                rows++;
+                count = 0;
+            }
+        }
+        return rows > 0;
+    }
+
+    // the values of a text that passed scan, in order
+    template<typename Cost>
+    void parse(const char* p, size_t n, Cost* out)
+    {
+        TextIO::NumberReader reader(p, n);
+        unsigned long long value;
+        while( reader.next(value) ) *out++ = value;
+    }
+
+    template<typename Cost, typename Visit>
+    void visit_as(const Text& text, size_t rows, size_t cols, Visit& visit)
+    {
+        Grid<Cost> grid;
+        grid.rows = rows;
+        grid.cols = cols;
+        grid.cells.resize(rows * cols);
+        parse(text.data, text.size, grid.cells.data());
+        visit(grid);
+    }
+}
+
+// parses text into a grid of the narrowest unsigned cost type that holds its largest value and hands
+// that to visit, which has to take a Grid of any cost type
+// the text is scanned twice, once for the shape and once for the values, so no wider copy is ever made
+template<typename Visit>
+bool load_grid(const GridLoad::Text& text, Visit visit)
+{
+    size_t rows, cols;
+    uint64_t largest;
+    if( !GridLoad::scan(text.data, text.size, rows, cols, largest) ) return false;
+    if( largest <= std::numeric_limits<uint8_t>::max() ) GridLoad::visit_as<uint8_t>(text, rows, cols, visit);
+    else if( largest <= std::numeric_limits<uint16_t>::max() ) GridLoad::visit_as<uint16_t>(text, rows, cols, visit);
+    else if( largest <= std::numeric_limits<uint32_t>::max() ) GridLoad::visit_as<uint32_t>(text, rows, cols, visit);
+    else GridLoad::visit_as<uint64_t>(text, rows, cols, visit);
+    return true;
+}
+
+// the matrix at path, or stdin for "-"
+template<typename Visit>
+bool load_grid(const std::string& path, Visit visit)
+{
+    GridLoad::Text text;
+    return GridLoad::read_text(path, text) && load_grid(text, visit);
+}
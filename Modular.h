@@ -0,0 +1,172 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Modular{
+    using u64 = unsigned long long;
+    using u128 = unsigned __int128;
+
+    // a*b mod m for any modulus m >= 1
+    inline u64 mulmod(u64 a, u64 b, u64 m)
+    {
+        return (u64)(((u128)a * b) % m);
+    }
+
+    // a+b mod m for a, b < m without a branch, the carry of a+b is folded in
+    inline u64 addmod(u64 a, u64 b, u64 m)
+    {
+        const u64 t = m - b;
+        const u64 s = a - t;
+        return s + (m & -(u64)(a < t));
+    }
+
+    // residues kept as plain values, works for every modulus
+    class PlainModulus
+    {
+    public:
+        explicit PlainModulus(u64 m) : m(m) {}
+
+        u64 modulus() const { return m; }
+        u64 to(u64 a) const { return a % m; }
+        u64 from(u64 a) const { return a; }
+        u64 one() const { return 1 % m; }
+        u64 mul(u64 a, u64 b) const { return mulmod(a, b, m); }
+
+    private:
+        u64 m;
+    };
+
+    // residues kept as a*2^64 mod m, odd moduli only
+    // the reduction is the hi(T) - hi(lo(T)*m^-1 * m) form, so any odd m < 2^64 fits without overflow
+    class Montgomery
+    {
+    public:
+        explicit Montgomery(u64 m) : m(m)
+        {
+            // Newton iteration for m^-1 mod 2^64, each step doubles the correct low bits
+            inv = m;
+            for( int i = 0; i < 5; i++ ) inv *= 2 - m * inv;
+            r2 = (u64)(((u128)1 << 64) % m);
+            r2 = mulmod(r2, r2, m);
+        }
+
+        u64 modulus() const { return m; }
+        u64 to(u64 a) const { return mul(a % m, r2); }
+        u64 from(u64 a) const { return reduce(a); }
+        u64 one() const { return to(1); }
+
+        u64 mul(u64 a, u64 b) const
+        {
+            return reduce((u128)a * b);
+        }
+
+        u64 reduce(u128 t) const
+        {
+            const u64 q = (u64)t * inv;
+            const u64 hi_t = (u64)(t >> 64);
+            const u64 hi_qm = (u64)(((u128)q * m) >> 64);
+            const u64 r = hi_t - hi_qm;
+            return r + (m & -(u64)(hi_t < hi_qm));
+        }
+
+    private:
+        u64 m;
+        u64 inv;
+        u64 r2;
+    };
+
+    // left to right sliding window exponentiation on residues of the ring, base and result in ring form
+    template<class Ring>
+    u64 pow(const Ring& ring, u64 a, u64 e)
+    {
+        if( e == 0 ) return ring.one();
+        constexpr int window = 4;
+        // odd powers a, a^3, ..., a^(2^window - 1)
+        u64 odd[1 << (window - 1)];
+        odd[0] = a;
+        const u64 a2 = ring.mul(a, a);
+        for( int i = 1; i < (1 << (window - 1)); i++ ) odd[i] = ring.mul(odd[i - 1], a2);
+
+        int bit = 63 - __builtin_clzll(e);
+        u64 res = ring.one();
+        bool started = false;
+        while( bit >= 0 )
+        {
+            if( !((e >> bit) & 1) )
+            {
+                if( started ) res = ring.mul(res, res);
+                bit--;
+                continue;
+            }
+            // longest window ending in a set bit
+            int low = bit - window + 1 < 0 ? 0 : bit - window + 1;
+            while( !((e >> low) & 1) ) low++;
+            const u64 digit = (e >> low) & ((1ULL << (bit - low + 1)) - 1);
+            if( started )
+            {
+                for( int i = low; i <= bit; i++ ) res = ring.mul(res, res);
+                res = ring.mul(res, odd[digit >> 1]);
+            }
+            else
+            {
+                res = odd[digit >> 1];
+                started = true;
+            }
+            bit = low - 1;
+        }
+        return res;
+    }
+
+    // a^e mod m, Montgomery form for odd moduli and plain 128 bit products otherwise
+    inline u64 powmod(u64 a, u64 e, u64 m)
+    {
+        if( m & 1 )
+        {
+            const Montgomery ring(m);
+            return ring.from(pow(ring, ring.to(a), e));
+        }
+        const PlainModulus ring(m);
+        return pow(ring, ring.to(a), e);
+    }
+
+    // (p+1)^n + (p-1)^n mod p^2, both powers share one ring and one pass over the bits of n
+    template<class Ring>
+    u64 binomial_power_sum(const Ring& ring, u64 p, u64 n)
+    {
+        const u64 plus = ring.to(p + 1);
+        const u64 minus = ring.to(p - 1);
+        u64 res_plus = ring.one();
+        u64 res_minus = ring.one();
+        for( int bit = n == 0 ? -1 : 63 - __builtin_clzll(n); bit >= 0; bit-- )
+        {
+            res_plus = ring.mul(res_plus, res_plus);
+            res_minus = ring.mul(res_minus, res_minus);
+            if( (n >> bit) & 1 )
+            {
+                res_plus = ring.mul(res_plus, plus);
+                res_minus = ring.mul(res_minus, minus);
+            }
+        }
+        return addmod(ring.from(res_plus), ring.from(res_minus), ring.modulus());
+    }
+
+    // batched (p[i]+1)^n[i] + (p[i]-1)^n[i] mod p[i]^2 for p[i] < 2^32
+    inline void binomial_power_sums(const u64* p, const u64* n, u64* out, size_t count)
+    {
+        for( size_t i = 0; i < count; i++ )
+        {
+            const u64 m = p[i] * p[i];
+            if( m & 1 ) out[i] = binomial_power_sum(Montgomery(m), p[i], n[i]);
+            else out[i] = binomial_power_sum(PlainModulus(m), p[i], n[i]);
+        }
+    }
+
+    inline std::vector<u64> binomial_power_sums(const std::vector<u64>& p, const std::vector<u64>& n)
+    {
+        std::vector<u64> out(p.size());
+        binomial_power_sums(p.data(), n.data(), out.data(), p.size());
+        return out;
+    }
+}
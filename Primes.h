@@ -5,129 +5,781 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <cstdint>
+#include <chrono>
+#include <numeric>
+#include <iterator>
+#include "ThreadPool.h"
+#include "TableCache.h"
+#include "Modular.h"
+#include "Random.h"
 
 
-constexpr int N_MAX = 1e6 + 1;
-constexpr int PRIME_MAX = N_MAX;
+// odd only sieve of Eratosthenes, bit j of word w stands for 2*(64*w + j) + 1 and is set while it may be prime
+// sieving runs over L1 sized segments so only the primes up to sqrt(limit) stay resident
+class SegmentedSieve
+{
+public:
+    static constexpr size_t segment_words = 4096;
 
-std::vector<int> primes = {2,3,5,7};
-std::array<bool, PRIME_MAX> b_is_prime = {};
+    // wheel pre-sieves 3, 5 and 7 by copying a 105 word pattern instead of crossing them off
+    explicit SegmentedSieve(unsigned long long limit, bool wheel = true) : limit(limit), wheel(wheel)
+    {
+        const unsigned long long root = sqrtl(limit) + 1;
+        std::vector<bool> composite(root + 1, false);
+        for( unsigned long long p = 3; p <= root; p += 2 )
+        {
+            if( composite[p] ) continue;
+            for( unsigned long long m = p * p; m <= root; m += 2 * p ) composite[m] = true;
+            if( wheel && p <= 7 ) continue;
+            sieving.push_back(p);
+            next.push_back((p * p) / 2);
+        }
+        if( wheel )
+        {
+            for( size_t w = 0; w < pattern.size(); w++ )
+            {
+                pattern[w] = 0;
+                for( int j = 0; j < 64; j++ )
+                {
+                    const unsigned long long n = 2 * (64 * w + j) + 1;
+                    if( n % 3 != 0 && n % 5 != 0 && n % 7 != 0 ) pattern[w] |= 1ULL << j;
+                }
+            }
+        }
+    }
 
-bool is_prime(unsigned long long num) {
-    if(num < 2) return false;
-    for(const auto &val:primes) {
-        if(val > num / val) return true;
-        if(num % val == 0) return false;
+    // number of words that cover the odd numbers below limit
+    unsigned long long word_count() const
+    {
+        return (limit / 2 + 63) / 64;
+    }
+
+    // sieves the next count words into words, returns false once everything below limit was produced
+    bool next_segment(uint64_t* words, size_t& count)
+    {
+        const unsigned long long total = word_count();
+        if( position >= total ) return false;
+        count = std::min<unsigned long long>(count, total - position);
+        sieve_range(words, position, count, next.data());
+        position += count;
+        return true;
+    }
+
+    // sieves count words starting at word first_word, independent of every other range
+    // next holds the index of the next multiple per sieving prime when ranges come in order
+    void sieve_range(uint64_t* words, unsigned long long first_word, size_t count, unsigned long long* next_multiple = nullptr) const
+    {
+        for( size_t w = 0; w < count; w++ ) words[w] = wheel ? pattern[(first_word + w) % pattern.size()] : ~0ULL;
+        const unsigned long long begin = first_word * 64;
+        const unsigned long long end = begin + count * 64;
+        for( size_t k = 0; k < sieving.size(); k++ )
+        {
+            const unsigned long long p = sieving[k];
+            unsigned long long j;
+            if( next_multiple != nullptr ) j = next_multiple[k];
+            else
+            {
+                // first odd multiple of p at or above 2*begin+1, but not below p*p
+                unsigned long long m = (2 * begin + 1 + p - 1) / p * p;
+                if( m % 2 == 0 ) m += p;
+                j = std::max(m / 2, (p * p) / 2);
+            }
+            for( ; j < end; j += p ) words[(j - begin) >> 6] &= ~(1ULL << (j & 63));
+            if( next_multiple != nullptr ) next_multiple[k] = j;
+        }
+
+        if( first_word == 0 )
+        {
+            words[0] &= ~1ULL;
+            if( wheel ) words[0] |= 0b1110;
+        }
+        // drop the bits of the odd numbers at or above limit
+        if( first_word + count == word_count() )
+        {
+            const unsigned long long odd_below = limit / 2;
+            if( odd_below % 64 != 0 ) words[count - 1] &= (1ULL << (odd_below % 64)) - 1;
+        }
+    }
+
+private:
+    unsigned long long limit;
+    bool wheel;
+    unsigned long long position = 0;
+    std::vector<unsigned long long> sieving;
+    std::vector<unsigned long long> next;
+    std::array<uint64_t, 105> pattern = {};
+};
+
+// calls visit(p) for every prime p < limit in increasing order, memory stays O(sqrt(limit)) plus one segment
+template<typename Visit>
+void for_each_prime(unsigned long long limit, Visit visit, bool wheel = true)
+{
+    if( limit <= 2 ) return;
+    visit(2ULL);
+    SegmentedSieve sieve(limit, wheel);
+    std::vector<uint64_t> words(SegmentedSieve::segment_words);
+    unsigned long long base = 0;
+    size_t count = words.size();
+    while( sieve.next_segment(words.data(), count) )
+    {
+        for( size_t w = 0; w < count; w++ )
+        {
+            for( uint64_t bits = words[w]; bits != 0; bits &= bits - 1 )
+            {
+                visit(2 * (base + 64 * w + __builtin_ctzll(bits)) + 1);
+            }
+        }
+        base += 64 * count;
+        count = words.size();
     }
-    return true;
 }
 
-void find_primes_to_n() {
-    for(unsigned long long i = 9; i < PRIME_MAX; i+=2) {
-        if(is_prime(i)) primes.push_back(i);
+// primes in [lo, hi) in increasing order, sieved one segment at a time as the iteration reaches it
+// the range holds the iteration state, so it is walked by one iterator at a time
+class PrimeRange
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = uint64_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint64_t*;
+        using reference = const uint64_t&;
+
+        iterator(PrimeRange* range, uint64_t value) : range(range), value(value) {}
+
+        uint64_t operator*() const { return value; }
+        iterator& operator++()
+        {
+            value = range->next();
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return value == other.value; }
+        bool operator!=(const iterator& other) const { return value != other.value; }
+
+    private:
+        PrimeRange* range;
+        uint64_t value;
+    };
+
+    PrimeRange(uint64_t lo, uint64_t hi) : lo(lo), hi(std::max(lo, hi)), sieve(std::max(lo, hi)), words(SegmentedSieve::segment_words)
+    {
+        next_word = lo / 128;
+    }
+
+    iterator begin() { return iterator(this, next()); }
+    iterator end() { return iterator(this, done); }
+
+private:
+    static constexpr uint64_t done = ~0ULL;
+
+    uint64_t next()
+    {
+        if( !two_checked )
+        {
+            two_checked = true;
+            if( lo <= 2 && 2 < hi ) return 2;
+        }
+        while( bits == 0 )
+        {
+            if( ++word < word_end )
+            {
+                bits = words[word - segment_begin];
+                continue;
+            }
+            if( next_word >= sieve.word_count() ) return done;
+            const size_t count = std::min<uint64_t>(words.size(), sieve.word_count() - next_word);
+            sieve.sieve_range(words.data(), next_word, count);
+            // the odd numbers below lo share the first word
+            if( next_word == lo / 128 ) words[0] &= ~0ULL << ((lo / 2) % 64);
+            segment_begin = next_word;
+            word = next_word;
+            word_end = next_word + count;
+            next_word = word_end;
+            bits = words[0];
+        }
+        const uint64_t p = 2 * (64 * word + __builtin_ctzll(bits)) + 1;
+        bits &= bits - 1;
+        return p;
     }
-    for( const auto&p : primes ) b_is_prime[p] = true;
+
+    uint64_t lo;
+    uint64_t hi;
+    SegmentedSieve sieve;
+    std::vector<uint64_t> words;
+    uint64_t next_word = 0;
+    uint64_t segment_begin = 0;
+    uint64_t word = 0;
+    uint64_t word_end = 0;
+    uint64_t bits = 0;
+    bool two_checked = false;
+};
+
+// number of primes up to x with the Lucy_Hedgehog recursion over the values x / i, O(x^(3/4)) time
+inline uint64_t prime_pi(uint64_t x)
+{
+    if( x < 2 ) return 0;
+    uint64_t r = sqrtl(x);
+    while( r * r > x ) r--;
+    while( (r + 1) * (r + 1) <= x ) r++;
+    // small[v] counts up to v, large[i] counts up to x / i, both start with every number from 2
+    std::vector<uint64_t> small(r + 1);
+    std::vector<uint64_t> large(r + 1);
+    for( uint64_t v = 1; v <= r; v++ ) small[v] = v - 1;
+    for( uint64_t i = 1; i <= r; i++ ) large[i] = x / i - 1;
+    for( uint64_t p = 2; p <= r; p++ )
+    {
+        if( small[p] == small[p - 1] ) continue;
+        // remove the numbers whose smallest prime factor is p
+        const uint64_t below = small[p - 1];
+        const uint64_t p2 = p * p;
+        const uint64_t large_end = std::min(r, x / p2);
+        for( uint64_t i = 1; i <= large_end; i++ )
+        {
+            const uint64_t d = i * p;
+            large[i] -= (d <= r ? large[d] : small[x / d]) - below;
+        }
+        for( uint64_t v = r; v >= p2; v-- ) small[v] -= small[v / p] - below;
+    }
+    return large[1];
 }
 
-template<size_t N>
-bool is_in_array(const std::array<int, N>& arr, int num)
+// bounds on the nth prime by Dusart, p(n) lies in [nth_prime_lower_bound(n), nth_prime_upper_bound(n)]
+inline uint64_t nth_prime_lower_bound(uint64_t n)
 {
-    for( const auto& a: arr )
+    if( n < 3 ) return n == 0 ? 0 : 2 * n - 1;
+    const long double ln = logl(n);
+    const long double lnln = logl(ln);
+    return std::max<long double>(0, n * (ln + lnln - 1 + (lnln - 2.1L) / ln) - 1);
+}
+
+inline uint64_t nth_prime_upper_bound(uint64_t n)
+{
+    constexpr uint64_t first[] = {0, 2, 3, 5, 7, 11, 13};
+    if( n <= 6 ) return first[n];
+    const long double ln = logl(n);
+    const long double lnln = logl(ln);
+    if( n >= 688383 ) return n * (ln + lnln - 1 + (lnln - 2) / ln) + 1;
+    if( n >= 39017 ) return n * (ln + lnln - 0.9484L) + 1;
+    return n * (ln + lnln) + 1;
+}
+
+// the nth prime, 1 based: a prime count up to the lower bound and a segmented walk from there
+inline uint64_t nth_prime(uint64_t n)
+{
+    if( n == 0 ) return 0;
+    const uint64_t lo = nth_prime_lower_bound(n);
+    uint64_t count = prime_pi(lo == 0 ? 0 : lo - 1);
+    for( const uint64_t p: PrimeRange(lo, nth_prime_upper_bound(n) + 1) )
     {
-        if( a == num ) return true;
-        if( a == 0 ) break;
+        if( ++count == n ) return p;
     }
-    return false;
+    return 0;
 }
 
-template<size_t N>
-void print_array(const std::array<int, N>& arr, int num)
+// bit packed primality of every number below limit, one bit per odd number
+class PrimeTable
 {
-    int sum = 0;
-    std::cout << num;
-    for(auto aa: arr)
+public:
+    void build(unsigned long long limit_, bool wheel = true)
     {
-        sum += aa;
-        if( aa == 0 ) break;
-        std::cout <<" " << aa;
+        assign(limit_, sieve(limit_, wheel));
     }
-    std::cout << " = " << sum << std::endl;
+
+    void assign(unsigned long long limit_, Table<uint64_t> words_)
+    {
+        limit = limit_;
+        words = std::move(words_);
+    }
+
+    // the words of a table for limit
+    static std::vector<uint64_t> sieve(unsigned long long limit, bool wheel = true)
+    {
+        const SegmentedSieve sieve(limit, wheel);
+        std::vector<uint64_t> words(sieve.word_count(), 0);
+        parallel_for(0, words.size(), [&](size_t lo, size_t hi)
+        {
+            sieve.sieve_range(words.data() + lo, lo, hi - lo);
+        }, SegmentedSieve::segment_words);
+        return words;
+    }
+
+    bool operator[](unsigned long long n) const
+    {
+        if( n >= limit || n % 2 == 0 ) return n == 2 && limit > 2;
+        return (words[n >> 7] >> ((n >> 1) & 63)) & 1;
+    }
+
+    unsigned long long size() const
+    {
+        return limit;
+    }
+
+    const Table<uint64_t>& data() const
+    {
+        return words;
+    }
+
+private:
+    unsigned long long limit = 0;
+    Table<uint64_t> words;
+};
+
+Table<int> primes = {2,3,5,7};
+PrimeTable b_is_prime;
+
+// deterministic Miller-Rabin for odd n > 2, the seven bases of Sinclair cover every 64 bit input
+inline bool miller_rabin(uint64_t n)
+{
+    const Modular::Montgomery ring(n);
+    const uint64_t one = ring.one();
+    const uint64_t minus_one = ring.to(n - 1);
+    const int s = __builtin_ctzll(n - 1);
+    const uint64_t d = (n - 1) >> s;
+    for( const uint64_t base: {2ULL, 325ULL, 9375ULL, 28178ULL, 450775ULL, 9780504ULL, 1795265022ULL} )
+    {
+        const uint64_t a = base % n;
+        if( a == 0 ) continue;
+        uint64_t x = Modular::pow(ring, ring.to(a), d);
+        if( x == one || x == minus_one ) continue;
+        bool composite = true;
+        for( int i = 1; i < s && composite; i++ )
+        {
+            x = ring.mul(x, x);
+            composite = x != minus_one;
+        }
+        if( composite ) return false;
+    }
+    return true;
 }
 
-template<size_t N>
-std::array<int, N> find_prime_factors(const int num, bool w_duplicates)
+// table lookup below the sieve limit, trial division by the primes below 64 and Miller-Rabin above it
+bool is_prime(unsigned long long num) {
+    if( num < b_is_prime.size() ) return b_is_prime[num];
+    if(num < 2) return false;
+    for( const unsigned long long p: {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61} )
+    {
+        if( num % p == 0 ) return num == p;
+    }
+    if( num < 67 * 67 ) return true;
+    return miller_rabin(num);
+}
+
+// primality tests per second over random 64 bit inputs, all odd inputs and inputs that pass the trial division
+void benchmark_is_prime(size_t count = 1000000)
+{
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    std::vector<uint64_t> odd(count);
+    for( auto& n: odd ) n = xorshift64(state) | 1;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t found = 0;
+    for( const auto n: odd ) found += is_prime(n);
+    auto stop = std::chrono::high_resolution_clock::now();
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << "is_prime random odd 64 bit: " << (uint64_t)(count / seconds) << " tests/s (" << found << " primes)";
+
+    std::vector<uint64_t> candidates;
+    for( const auto n: odd )
+    {
+        if( n % 3 && n % 5 && n % 7 && n % 11 && n % 13 ) candidates.push_back(n);
+    }
+    start = std::chrono::high_resolution_clock::now();
+    found = 0;
+    for( const auto n: candidates ) found += miller_rabin(n);
+    stop = std::chrono::high_resolution_clock::now();
+    std::cout << ", miller_rabin on trial division survivors: " << (uint64_t)(candidates.size() / std::chrono::duration<double>(stop - start).count()) << " tests/s (" << found << " primes)" << std::endl;
+}
+
+// fills primes and b_is_prime with every prime below limit, both are mapped from the table cache when it has them
+void find_primes_to_n(unsigned long long limit) {
+    b_is_prime.assign(limit, cached_table<uint64_t>("b_is_prime", 1, limit, 0, [limit]{ return PrimeTable::sieve(limit); }));
+    primes = cached_table<int>("primes", 1, limit, 0, [limit]
+    {
+        std::vector<int> res;
+        if( limit > 2 ) res.push_back(2);
+        const auto& words = b_is_prime.data();
+        for( size_t w = 0; w < words.size(); w++ )
+        {
+            for( uint64_t bits = words[w]; bits != 0; bits &= bits - 1 )
+            {
+                res.push_back(2 * (64 * w + __builtin_ctzll(bits)) + 1);
+            }
+        }
+        return res;
+    });
+}
+
+// prime factorization as (prime, exponent) pairs in increasing order, stored inline
+template<typename Prime, size_t N>
+struct BasicFactorization
+{
+    struct Factor
+    {
+        Prime prime;
+        uint32_t exponent;
+    };
+
+    std::array<Factor, N> factors;
+    uint32_t count = 0;
+
+    const Factor* begin() const { return factors.data(); }
+    const Factor* end() const { return factors.data() + count; }
+    uint32_t size() const { return count; }
+};
+
+// 2*3*5*...*29 exceeds 2^32 and 2*3*5*...*53 exceeds 2^64
+using Factorization = BasicFactorization<uint32_t, 9>;
+using Factorization64 = BasicFactorization<uint64_t, 15>;
+
+// odd and even primes up to limit with a plain sieve, the sieving primes of the segmented builders
+inline std::vector<uint32_t> small_primes(uint32_t limit)
 {
-    if( b_is_prime[num] )
+    std::vector<uint32_t> res;
+    std::vector<bool> composite(limit + 1, false);
+    for( uint64_t p = 2; p <= limit; p++ )
     {
-        return {};
+        if( composite[p] ) continue;
+        res.push_back(p);
+        for( uint64_t m = p * p; m <= limit; m += p ) composite[m] = true;
     }
+    return res;
+}
 
-    std::array<int, N> factors;
-    int offset = 0;
-    int n = num;
-    while( n > 1 )
+// smallest prime factor of every number below limit
+// composites have their smallest factor below 2^16 for limits up to 2^32, primes are stored as 0
+class SpfTable
+{
+public:
+    // chunks are sieved in parallel, each with the primes up to sqrt(limit) in increasing order
+    // so the first prime to reach a number is its smallest factor
+    void build(uint32_t limit_)
     {
-        if( b_is_prime[ n ] && n != num )
+        limit = limit_;
+        spf.assign(limit, 0);
+        const auto sieving = small_primes(sqrt(limit) + 1);
+        parallel_for(0, limit, [&](size_t lo, size_t hi)
         {
-            if( w_duplicates || offset == 0 || factors[offset - 1] != n )
+            for( const uint64_t p: sieving )
             {
-                factors[offset++] = n;
+                for( uint64_t m = std::max(p * p, (lo + p - 1) / p * p); m < hi; m += p )
+                {
+                    if( spf[m] == 0 ) spf[m] = p;
+                }
             }
-            break;
+        }, 1 << 15);
+    }
+
+    // smallest prime factor of n for 2 <= n < size()
+    uint32_t operator[](uint32_t n) const
+    {
+        return spf[n] == 0 ? n : spf[n];
+    }
+
+    Factorization factorize(uint32_t n) const
+    {
+        assert( n < limit );
+        Factorization res;
+        while( n > 1 )
+        {
+            const uint32_t p = (*this)[n];
+            uint32_t exponent = 0;
+            do
+            {
+                n /= p;
+                exponent++;
+            } while( n > 1 && (*this)[n] == p );
+            res.factors[res.count++] = {p, exponent};
         }
-        for( const auto& p: primes )
+        return res;
+    }
+
+    uint32_t size() const
+    {
+        return limit;
+    }
+
+private:
+    uint32_t limit = 0;
+    std::vector<uint16_t> spf;
+};
+
+SpfTable smallest_prime_factors;
+
+// a non trivial factor of the odd composite n by Brent's variant of Pollard rho on x^2 + c
+// the differences are multiplied up and the gcd taken once per batch of 128 steps
+inline uint64_t pollard_brent(uint64_t n)
+{
+    constexpr uint64_t batch = 128;
+    const Modular::Montgomery ring(n);
+    for( uint64_t c = 1; ; c++ )
+    {
+        const uint64_t cm = ring.to(c);
+        auto f = [&](uint64_t x){ return Modular::addmod(ring.mul(x, x), cm, n); };
+        uint64_t y = ring.to(2);
+        uint64_t x = y;
+        uint64_t ys = y;
+        uint64_t q = ring.one();
+        uint64_t g = 1;
+        for( uint64_t r = 1; g == 1; r *= 2 )
         {
-            if( n % p == 0 )
+            x = y;
+            for( uint64_t i = 0; i < r; i++ ) y = f(y);
+            for( uint64_t k = 0; k < r && g == 1; k += batch )
             {
-                if( w_duplicates || offset == 0 || factors[offset - 1] != p )
+                ys = y;
+                for( uint64_t i = 0; i < std::min(batch, r - k); i++ )
                 {
-                    factors[offset++] = p;
+                    y = f(y);
+                    q = ring.mul(q, x > y ? x - y : y - x);
                 }
-                n /=p;
-                break;
+                // q is in Montgomery form, which does not change its gcd with n
+                g = std::gcd(q, n);
             }
         }
+        if( g == n )
+        {
+            // the batch ran past the factor, redo it from its start one gcd at a time
+            do
+            {
+                ys = f(ys);
+                g = std::gcd(x > ys ? x - ys : ys - x, n);
+            } while( g == 1 );
+        }
+        if( g != n ) return g;
+    }
+}
+
+// factorization of any 64 bit n: the smallest prime factor table below its limit, otherwise
+// trial division by the primes below 1024 and Pollard-Brent on the cofactor
+inline Factorization64 factorize_u64(uint64_t n)
+{
+    Factorization64 res;
+    if( n < smallest_prime_factors.size() )
+    {
+        for( const auto& f: smallest_prime_factors.factorize(n) ) res.factors[res.count++] = {f.prime, f.exponent};
+        return res;
+    }
+
+    static const auto trial = small_primes(1 << 10);
+    for( const uint64_t p: trial )
+    {
+        if( p * p > n ) break;
+        if( n % p != 0 ) continue;
+        uint32_t exponent = 0;
+        do
+        {
+            n /= p;
+            exponent++;
+        } while( n % p == 0 );
+        res.factors[res.count++] = {p, exponent};
+    }
+    if( n == 1 ) return res;
+
+    // split the cofactor into primes, at most 64 of them
+    std::array<uint64_t, 64> found;
+    size_t found_count = 0;
+    std::array<uint64_t, 64> pending;
+    size_t pending_count = 0;
+    pending[pending_count++] = n;
+    while( pending_count > 0 )
+    {
+        const uint64_t m = pending[--pending_count];
+        // every factor of m is above 1021
+        if( m < (1 << 20) || is_prime(m) )
+        {
+            found[found_count++] = m;
+            continue;
+        }
+        const uint64_t d = pollard_brent(m);
+        pending[pending_count++] = d;
+        pending[pending_count++] = m / d;
     }
+    std::sort(found.begin(), found.begin() + found_count);
+    for( size_t i = 0; i < found_count; i++ )
+    {
+        if( res.count > 0 && res.factors[res.count - 1].prime == found[i] ) res.factors[res.count - 1].exponent++;
+        else res.factors[res.count++] = {found[i], 1};
+    }
+    return res;
+}
 
-    factors[offset] = 0;
-    return factors;
+// time per factorization of random 64 bit inputs
+void benchmark_factorize_u64(size_t count = 2000)
+{
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t check = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for( size_t i = 0; i < count; i++ ) for( const auto& f: factorize_u64(xorshift64(state)) ) check += f.prime * f.exponent;
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "factorize_u64 random 64 bit: " << std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count() / count << "mus per number (checksum " << check << ")" << std::endl;
 }
 
-template<size_t N>
-std::array<int, N> find_all_distinct_factors(const int num)
+// f(n) for every n < limit of a multiplicative function f, prime_power(p, e, p^e) returns f(p^e)
+// chunks are independent segments: every prime up to sqrt(limit) divides its power out of its
+// multiples, whatever is left above 1 is the one prime factor beyond sqrt(limit)
+template<typename T, typename PrimePower>
+std::vector<T> multiplicative_sieve(uint32_t limit, PrimePower prime_power)
 {
-    auto factors = find_prime_factors<N>(num, true);
-    std::array<int, N> all_factors = {};
-    int all_offset = 0;
-    std::function<void(const int start_offset, const int start_prod)> get_factors = [&](int start_offset, int start_prod){
-        for( int i = start_offset; i  < N; i++ )
+    std::vector<T> f(limit, T(0));
+    const auto sieving = small_primes(sqrt(limit) + 1);
+    parallel_for(0, limit, [&](size_t lo, size_t hi)
+    {
+        std::vector<uint32_t> rest(hi - lo);
+        for( size_t n = lo; n < hi; n++ )
         {
-            if( factors[i] == 0 ) break;
-            auto prod = start_prod * factors[i];
-            if( num % prod == 0 && prod < num )
+            rest[n - lo] = n;
+            f[n] = T(1);
+        }
+        for( const uint64_t p: sieving )
+        {
+            for( uint64_t m = std::max(p, (lo + p - 1) / p * p); m < hi; m += p )
             {
-                // all_factors[all_offset] = 0;
-                if(!is_in_array(all_factors, prod) )
+                uint32_t r = rest[m - lo];
+                uint32_t e = 0;
+                uint32_t pe = 1;
+                do
                 {
-                    all_factors[all_offset++] = prod;
-                }
-                get_factors( i + 1, prod );
+                    r /= p;
+                    e++;
+                    pe *= p;
+                } while( r % p == 0 );
+                rest[m - lo] = r;
+                f[m] = f[m] * prime_power(p, e, pe);
             }
         }
-    };
-    for(int i = 0; i < N; i++)
+        for( size_t n = std::max<size_t>(lo, 2); n < hi; n++ )
+        {
+            const uint32_t r = rest[n - lo];
+            if( r > 1 ) f[n] = f[n] * prime_power(r, 1, r);
+        }
+        if( lo == 0 ) f[0] = T(0);
+    });
+    return f;
+}
+
+// sum of value(d) over the divisors d of every n < limit, n itself left out when proper is set
+template<typename T, typename Value>
+std::vector<T> divisor_sum_sieve(uint32_t limit, Value value, bool proper = false)
+{
+    std::vector<T> sums(limit, T(0));
+    for( uint32_t d = 1; d < limit; d++ )
     {
-        if( factors[i] == 0 ) break;
-        get_factors(i+1, factors[i]);
+        const T v = value(d);
+        for( uint64_t m = proper ? 2 * (uint64_t)d : d; m < limit; m += d ) sums[m] += v;
     }
-    all_factors[all_offset++] = 1;
-    int last_f = -1;
-    for( const auto& f: factors )
+    return sums;
+}
+
+// sum of the k-th powers of the divisors, T has to hold every sum below limit
+template<typename T = uint64_t>
+std::vector<T> divisor_sigma(uint32_t limit, uint32_t k = 1)
+{
+    return multiplicative_sieve<T>(limit, [k](uint32_t p, uint32_t e, uint32_t)
+    {
+        uint64_t pk = 1;
+        for( uint32_t j = 0; j < k; j++ ) pk *= p;
+        uint64_t sum = 1;
+        uint64_t term = 1;
+        for( uint32_t j = 0; j < e; j++ )
+        {
+            term *= pk;
+            sum += term;
+        }
+        return T(sum);
+    });
+}
+
+inline std::vector<uint32_t> divisor_count(uint32_t limit)
+{
+    return multiplicative_sieve<uint32_t>(limit, [](uint32_t, uint32_t e, uint32_t){ return e + 1; });
+}
+
+inline std::vector<uint32_t> euler_phi(uint32_t limit)
+{
+    return multiplicative_sieve<uint32_t>(limit, [](uint32_t p, uint32_t, uint32_t pe){ return pe - pe / p; });
+}
+
+inline std::vector<int8_t> mobius(uint32_t limit)
+{
+    return multiplicative_sieve<int8_t>(limit, [](uint32_t, uint32_t e, uint32_t){ return int8_t(e == 1 ? -1 : 0); });
+}
+
+// aliquot sum s(n) = sigma(n) - n, the sum of the divisors below n
+// sigma(n) < 2^32 for every n below 1e8, so uint32_t halves the table there
+template<typename T = uint64_t>
+std::vector<T> aliquot_sums(uint32_t limit)
+{
+    auto sums = divisor_sigma<T>(limit);
+    for( uint32_t n = 1; n < limit; n++ ) sums[n] -= n;
+    return sums;
+}
+
+// time to build the table below limit and to factor every number in it
+void benchmark_factorize(uint32_t limit = 1e7)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    SpfTable table;
+    table.build(limit);
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "spf table to " << limit << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << "ms";
+
+    start = std::chrono::high_resolution_clock::now();
+    unsigned long long check = 0;
+    for( uint32_t n = 2; n < limit; n++ )
     {
-        if( f == 0 ) break;
-        if( f != last_f ) all_factors[all_offset++] = f;
-        last_f = f;
+        for( const auto& f: table.factorize(n) ) check += f.prime * f.exponent;
     }
-    all_factors[all_offset] = 0;
+    stop = std::chrono::high_resolution_clock::now();
+    std::cout << ", factorize all: " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << "ms (checksum " << check << ")" << std::endl;
+}
+
+template<size_t N>
+bool is_in_array(const std::array<int, N>& arr, int num)
+{
+    for( const auto& a: arr )
+    {
+        if( a == num ) return true;
+        if( a == 0 ) break;
+    }
+    return false;
+}
+
+template<size_t N>
+void print_array(const std::array<int, N>& arr, int num)
+{
+    int sum = 0;
+    std::cout << num;
+    for(auto aa: arr)
+    {
+        sum += aa;
+        if( aa == 0 ) break;
+        std::cout <<" " << aa;
+    }
+    std::cout << " = " << sum << std::endl;
+}
+
+// every divisor of num below num, zero terminated, built from the prime powers of its factorization
+template<size_t N>
+std::array<int, N> find_all_distinct_factors(const int num)
+{
+    std::array<int, N> all_factors = {};
+    all_factors[0] = 1;
+    int all_offset = 1;
+    for( const auto& f: smallest_prime_factors.factorize(num) )
+    {
+        const int current = all_offset;
+        int power = 1;
+        for( uint32_t e = 0; e < f.exponent; e++ )
+        {
+            power *= f.prime;
+            for( int i = 0; i < current; i++ ) all_factors[all_offset++] = all_factors[i] * power;
+        }
+    }
+    // the last product is num itself
+    if( num > 1 ) all_factors[--all_offset] = 0;
     return all_factors;
-}
\ No newline at end of file
+}
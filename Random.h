@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// seed of the benchmark inputs, any nonzero value works
+constexpr uint64_t XORSHIFT_SEED = 88172645463325252ULL;
+
+// Marsaglia's xorshift64, advances state and returns it; cheap and reproducible inputs for tests and benchmarks
+inline uint64_t xorshift64(uint64_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// read only table that either owns its values or views them inside a mapped cache file
+template<typename T>
+class Table
+{
+    static_assert(std::is_trivially_copyable<T>::value, "tables are stored as raw bytes");
+
+public:
+    Table() = default;
+    Table(std::initializer_list<T> values) : owned(values) { attach_owned(); }
+    Table(std::vector<T> values) : owned(std::move(values)) { attach_owned(); }
+
+    Table(const Table& other) : owned(other.owned), view(other.view), count(other.count), mapping(other.mapping)
+    {
+        if( !mapping ) attach_owned();
+    }
+
+    Table(Table&& other) noexcept : owned(std::move(other.owned)), view(other.view), count(other.count), mapping(std::move(other.mapping))
+    {
+        if( !mapping ) attach_owned();
+    }
+
+    Table& operator=(Table other)
+    {
+        owned.swap(other.owned);
+        mapping.swap(other.mapping);
+        view = other.view;
+        count = other.count;
+        if( !mapping ) attach_owned();
+        return *this;
+    }
+
+    // values inside a mapping that stays alive as long as any table refers to it
+    static Table mapped(std::shared_ptr<void> mapping, const T* values, size_t count)
+    {
+        Table res;
+        res.mapping = std::move(mapping);
+        res.view = values;
+        res.count = count;
+        return res;
+    }
+
+    const T& operator[](size_t i) const { return view[i]; }
+    const T* begin() const { return view; }
+    const T* end() const { return view + count; }
+    const T* data() const { return view; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool is_mapped() const { return mapping != nullptr; }
+
+private:
+    void attach_owned()
+    {
+        view = owned.data();
+        count = owned.size();
+    }
+
+    std::vector<T> owned;
+    const T* view = nullptr;
+    size_t count = 0;
+    std::shared_ptr<void> mapping;
+};
+
+namespace TableCache{
+    constexpr char magic[8] = {'E', 'U', 'L', 'T', 'A', 'B', 'L', 'E'};
+    constexpr uint32_t format_version = 2;
+
+    // 64 bytes so the values that follow stay aligned for any element type
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t element_width;
+        uint64_t count;
+        uint64_t limit;
+        uint64_t params;
+        uint64_t checksum;
+        uint32_t builder;
+        uint32_t reserved[3];
+    };
+    static_assert(sizeof(Header) == 64, "header layout is part of the file format");
+
+    // word wise multiply xor hash over the values, checked once right after a table is written
+    inline uint64_t checksum(const void* data, size_t bytes)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        uint64_t h = 0x9e3779b97f4a7c15ULL ^ bytes;
+        size_t i = 0;
+        for( ; i + 8 <= bytes; i += 8 )
+        {
+            uint64_t w;
+            std::memcpy(&w, p + i, 8);
+            h = (h ^ w) * 0xff51afd7ed558ccdULL;
+            h ^= h >> 32;
+        }
+        for( ; i < bytes; i++ ) h = (h ^ p[i]) * 0x100000001b3ULL;
+        return h;
+    }
+
+    // caching is opt in, tables are only kept when EULER_CACHE_DIR names a directory
+    inline std::string directory()
+    {
+        const char* env = std::getenv("EULER_CACHE_DIR");
+        return env != nullptr ? std::string(env) : std::string();
+    }
+
+    // maps path into table if it holds a complete table of the expected shape
+    // the header and the file size are checked on every load, the checksum of the values only when verify is set
+    template<typename T>
+    bool load(const std::string& path, uint32_t builder, uint64_t limit, uint64_t params, Table<T>& table, bool verify = false)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if( fd < 0 ) return false;
+        struct stat st;
+        if( fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header) )
+        {
+            close(fd);
+            return false;
+        }
+        const size_t bytes = st.st_size;
+        void* base = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if( base == MAP_FAILED ) return false;
+        std::shared_ptr<void> mapping(base, [bytes](void* p){ munmap(p, bytes); });
+
+        const Header* header = static_cast<const Header*>(base);
+        const T* values = reinterpret_cast<const T*>(static_cast<const char*>(base) + sizeof(Header));
+        if( std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != format_version ) return false;
+        if( header->builder != builder || header->element_width != sizeof(T) || header->limit != limit || header->params != params ) return false;
+        if( header->count > (bytes - sizeof(Header)) / sizeof(T) || sizeof(Header) + header->count * sizeof(T) != bytes ) return false;
+        if( verify && checksum(values, header->count * sizeof(T)) != header->checksum ) return false;
+
+        table = Table<T>::mapped(std::move(mapping), values, header->count);
+        return true;
+    }
+
+    // writes to a temporary file and renames it, so readers only ever see complete tables
+    template<typename T>
+    bool store(const std::string& path, uint32_t builder, uint64_t limit, uint64_t params, const std::vector<T>& values)
+    {
+        Header header = {};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = format_version;
+        header.builder = builder;
+        header.element_width = sizeof(T);
+        header.count = values.size();
+        header.limit = limit;
+        header.params = params;
+        header.checksum = checksum(values.data(), values.size() * sizeof(T));
+
+        const std::string tmp = path + ".tmp" + std::to_string(getpid());
+        FILE* file = std::fopen(tmp.c_str(), "wb");
+        if( file == nullptr ) return false;
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        if( ok && !values.empty() ) ok = std::fwrite(values.data(), sizeof(T), values.size(), file) == values.size();
+        ok = std::fclose(file) == 0 && ok;
+        if( ok ) ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+        if( !ok ) std::remove(tmp.c_str());
+        return ok;
+    }
+}
+
+// the table stored under name for this limit and params, built and written on a miss
+// builder is the version of what build writes and has to be bumped whenever its layout or contents change
+// every builder version and limit gets its own file so programs sharing a table name do not evict each other
+// a cache file for another builder, limit, params, element width or format version counts as a miss
+template<typename T, typename Build>
+Table<T> cached_table(const std::string& name, uint32_t builder, uint64_t limit, uint64_t params, Build build)
+{
+    const std::string dir = TableCache::directory();
+    if( dir.empty() ) return Table<T>(build());
+    const std::string path = dir + "/" + name + "-v" + std::to_string(builder) + "-" + std::to_string(limit) + ".bin";
+
+    Table<T> table;
+    if( TableCache::load(path, builder, limit, params, table) ) return table;
+
+    std::vector<T> values = build();
+    mkdir(dir.c_str(), 0755);
+    if( TableCache::store(path, builder, limit, params, values) && TableCache::load(path, builder, limit, params, table, true) ) return table;
+    return Table<T>(std::move(values));
+}
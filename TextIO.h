@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+
+// whole input streams in one buffer, unsigned numbers parsed straight from it and output gathered for one write
+namespace TextIO{
+    // everything left on file, the buffer doubles until a read comes back empty
+    inline std::vector<char> read_all(FILE* file)
+    {
+        std::vector<char> buffer(1 << 16);
+        size_t length = 0;
+        while( true )
+        {
+            if( length == buffer.size() ) buffer.resize(buffer.size() * 2);
+            const size_t got = std::fread(buffer.data() + length, 1, buffer.size() - length, file);
+            if( got == 0 ) break;
+            length += got;
+        }
+        buffer.resize(length);
+        return buffer;
+    }
+
+    // unsigned decimal numbers of a text in order, anything but a digit separates them
+    class NumberReader
+    {
+    public:
+        NumberReader(const char* data, size_t size) : data(data), size(size) {}
+
+        bool next(unsigned long long& value)
+        {
+            while( pos < size && (data[pos] < '0' || data[pos] > '9') ) pos++;
+            if( pos == size ) return false;
+            value = 0;
+            while( pos < size && data[pos] >= '0' && data[pos] <= '9' ) value = value * 10 + (data[pos++] - '0');
+            return true;
+        }
+
+    private:
+        const char* data;
+        size_t size;
+        size_t pos = 0;
+    };
+
+    // text collected in one buffer and written with a single call
+    class Writer
+    {
+    public:
+        void reserve(size_t bytes)
+        {
+            out.reserve(bytes);
+        }
+
+        void put(char c)
+        {
+            out.push_back(c);
+        }
+
+        void number(unsigned long long value)
+        {
+            char digits[24];
+            int d = 0;
+            do
+            {
+                digits[d++] = '0' + value % 10;
+                value /= 10;
+            } while( value > 0 );
+            while( d > 0 ) out.push_back(digits[--d]);
+        }
+
+        void flush(FILE* file = stdout)
+        {
+            std::fwrite(out.data(), 1, out.size(), file);
+            out.clear();
+        }
+
+    private:
+        std::vector<char> out;
+    };
+}
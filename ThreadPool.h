@@ -0,0 +1,199 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+// work stealing pool, every worker owns a deque and takes its newest task first,
+// idle workers steal the oldest task of another deque, tasks may submit further tasks
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency())
+    {
+        thread_count = std::max<size_t>(thread_count, 1);
+        for( size_t i = 0; i < thread_count; i++ ) queues.emplace_back(new Queue);
+        for( size_t i = 0; i < thread_count; i++ )
+        {
+            workers.emplace_back([this, i]{ work(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        task_ready.notify_all();
+        for( auto& worker: workers ) worker.join();
+    }
+
+    // tasks submitted by a worker go to its own deque, others are spread round robin
+    void submit(std::function<void()> task)
+    {
+        const size_t target = current_pool == this ? current_index : next_queue++ % queues.size();
+        // counted before the push so a worker never takes a task that is not counted yet
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued++;
+            unfinished++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        task_ready.notify_one();
+    }
+
+    // blocks until every submitted task, including the ones submitted by tasks, has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this]{ return unfinished == 0; });
+    }
+
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    // true on the threads of this pool
+    bool is_worker() const
+    {
+        return current_pool == this;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool pop(size_t index, std::function<void()>& task)
+    {
+        {
+            Queue& own = *queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if( !own.tasks.empty() )
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for( size_t k = 1; k < queues.size(); k++ )
+        {
+            Queue& other = *queues[(index + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if( !other.tasks.empty() )
+            {
+                task = std::move(other.tasks.front());
+                other.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t index)
+    {
+        current_pool = this;
+        current_index = index;
+        while( true )
+        {
+            std::function<void()> task;
+            if( !pop(index, task) )
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if( queued == 0 && stopping ) return;
+                task_ready.wait(lock, [this]{ return stopping || queued > 0; });
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued--;
+            }
+            task();
+            std::lock_guard<std::mutex> lock(mutex);
+            if( --unfinished == 0 ) all_done.notify_all();
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    std::condition_variable all_done;
+    std::atomic<size_t> next_queue{0};
+    size_t queued = 0;
+    size_t unfinished = 0;
+    bool stopping = false;
+
+    static inline thread_local ThreadPool* current_pool = nullptr;
+    static inline thread_local size_t current_index = 0;
+};
+
+// one pool per program for the table builders
+inline ThreadPool& shared_pool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// body(lo, hi) over [begin, end) in chunks of grain indices, boundaries depend only on begin and grain
+// so the split is the same for any thread count; the calling thread takes chunks as well, which
+// keeps nested calls from a pool task from waiting on workers that are all busy
+// the default grain of 16K indices keeps a chunk of a byte or int table within L1 or L2,
+// grains are rounded to 64 indices so neighbouring chunks of byte tables do not share cache lines
+template<typename Body>
+void parallel_for(size_t begin, size_t end, Body body, size_t grain = 1 << 14, ThreadPool& pool = shared_pool())
+{
+    if( begin >= end ) return;
+    grain = std::max<size_t>((grain + 63) / 64 * 64, 64);
+    const size_t chunks = (end - begin + grain - 1) / grain;
+    if( chunks == 1 || pool.size() == 1 )
+    {
+        for( size_t lo = begin; lo < end; lo += grain ) body(lo, std::min(end, lo + grain));
+        return;
+    }
+
+    struct Loop
+    {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto loop = std::make_shared<Loop>();
+    auto run = [loop, begin, end, grain, chunks, &body]
+    {
+        for( size_t c = loop->next++; c < chunks; c = loop->next++ )
+        {
+            const size_t lo = begin + c * grain;
+            body(lo, std::min(end, lo + grain));
+            if( ++loop->done == chunks )
+            {
+                std::lock_guard<std::mutex> lock(loop->mutex);
+                loop->finished.notify_all();
+            }
+        }
+    };
+
+    // helpers that start after the last chunk was taken return at once without touching body
+    const size_t helpers = std::min(chunks, pool.size()) - (pool.is_worker() ? 1 : 0);
+    for( size_t i = 0; i < helpers; i++ ) pool.submit(run);
+    run();
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&]{ return loop->done == chunks; });
+}
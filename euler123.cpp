@@ -1,4 +1,5 @@
 #include <map>
+#include <array>
 #include <vector>
 #include <algorithm>
 #include <iostream>
@@ -6,44 +7,40 @@
 #include <cassert>
 #include <chrono>
 #include <math.h>
+#include <cstdio>
+#include <cstdint>
+#include <utility>
 
 #include "BigInt.h"
-
-#define PRIME_MAX 3500
+#include "Modular.h"
+#include "Primes.h"
+#include "TextIO.h"
+#include "Random.h"
 
 using namespace PositiveBigInt;
 using namespace std::chrono;
 
 constexpr unsigned long long B_EDGE = 1e12;
 constexpr unsigned long long N_MAX = 2.7e6;
-constexpr unsigned long long e12 = 2617253;
-constexpr unsigned long long e11 = 790547;
-constexpr unsigned long long e10 = 237737;
-std::vector<unsigned long long> primes = {2,3,5,7};
-std::array<unsigned long, N_MAX> solutions = {};
-std::array<int, N_MAX> solution_indices = {};
-
-bool is_prime(unsigned long long num) {
-    if(num < 2) return false;
-    for(const auto &val:primes) {
-        if(val > num / val) return true;
-        if(num % val == 0) return false;
-    }
-    return true;
-}
 
-void find_primes_to_n() {
-    for(unsigned long long i = 9; i < N_MAX; i+=2) {
-        if(is_prime(i)) primes.push_back(i);
-    }
-}
+// remainders of (p_n+1)^n + (p_n-1)^n mod p_n^2 by n, entry n-1 of every column belongs to n
+// one column per field so a scan over the remainders or the running maximum stays dense
+struct SolutionTable
+{
+    Table<uint32_t> prime;
+    Table<uint64_t> remainder;
+    Table<uint64_t> running_max;
 
-// a^b
-unsigned long long power_of_n(const unsigned long long& a, const unsigned long long& b, const unsigned long long& divisor = 1e18)
+    size_t size() const { return prime.size(); }
+    size_t bytes() const { return size() * (sizeof(uint32_t) + 2 * sizeof(uint64_t)); }
+};
+SolutionTable solutions;
+
+// a^b, the map of repeated squares with a BigInt fallback on overflow, kept as benchmark reference
+unsigned long long power_of_n_reference(const unsigned long long& a, const unsigned long long& b, const unsigned long long& divisor = 1e18)
 {
     if( b == 0 ) return 1;
 
-    constexpr int max_digits = 35;
     int c = 1;
     int total_c = 1;
     unsigned long long res = a;
@@ -56,7 +53,7 @@ unsigned long long power_of_n(const unsigned long long& a, const unsigned long l
         // handle overflow
         if( res_ / factor != res )
         {
-            BigInt b_res = BigInt(factor, 0, max_digits );
+            BigInt b_res = BigInt(factor);
             b_res *= res;// BigInt(res, 0 , max_digits);
             res = b_res.modulo(divisor); //b_res.modulo(divisor);
         }
@@ -73,7 +70,7 @@ unsigned long long power_of_n(const unsigned long long& a, const unsigned long l
             // handle overflow
             if( factor_ / factor != factor )
             {
-                BigInt b_res = BigInt(factor, 0, max_digits );
+                BigInt b_res = BigInt(factor);
                 b_res *= b_res;
                 factor = b_res.modulo(divisor);
             }
@@ -102,18 +99,10 @@ unsigned long long power_of_n(const unsigned long long& a, const unsigned long l
     return res;
 }
 
-unsigned long long calc_remainder( int n )
+// a^b
+unsigned long long power_of_n(const unsigned long long& a, const unsigned long long& b, const unsigned long long& divisor = 1e18)
 {
-    const unsigned long long prime = primes[ n-1 ];
-    const unsigned long long divisor = prime * prime;
-    const unsigned long long prime_plus = prime + 1;
-    const unsigned long long prime_minus = prime - 1;
-
-
-    unsigned long long prime_plus_res = power_of_n( prime_plus, n, divisor );
-    unsigned long long prime_minus_res = power_of_n( prime_minus, n, divisor );
-    unsigned long long res = ((prime_plus_res % divisor) + (prime_minus_res % divisor )) % divisor;
-    return res;
+    return Modular::powmod(a, b, divisor);
 }
 
 void unit_power_test(unsigned long long a, unsigned long long b, unsigned long long expected)
@@ -133,18 +122,335 @@ void unit_power_tests()
     unit_power_test(3,10, 59049);
     unit_power_test(3,11, 177147);
     unit_power_test(3,23, 94143178827);
+    unit_power_test(3,40, 157665459056928801);
+    unit_power_test(7,1000003, 906089245800000343);
 }
 
-unsigned long long calc_larger_e11(unsigned long long num, long c = 0, long a = 549893, long b = 19303243 )
+// ns per call of the old and the new a^b mod p^2 and of the batched remainders
+void benchmark_power()
 {
-    return (a*log2((num + c)) - b);
+    constexpr int count = 20000;
+    std::vector<unsigned long long> p, n;
+    unsigned long long i = 0;
+    for( const auto prime: PrimeRange(2, nth_prime_upper_bound(2 * count) + 1) )
+    {
+        if( ++i > 2 * count ) break;
+        if( i % 2 == 0 ) continue;
+        p.push_back(prime);
+        n.push_back(i);
+    }
+
+    unsigned long long check = 0;
+    auto start = high_resolution_clock::now();
+    for( int i = 0; i < count; i++ ) check += power_of_n_reference(p[i] + 1, n[i], p[i] * p[i]);
+    auto stop = high_resolution_clock::now();
+    std::cout << "power_of_n_reference: " << duration_cast<nanoseconds>(stop - start).count() / count << "ns";
+
+    start = high_resolution_clock::now();
+    for( int i = 0; i < count; i++ ) check -= power_of_n(p[i] + 1, n[i], p[i] * p[i]);
+    stop = high_resolution_clock::now();
+    std::cout << ", power_of_n: " << duration_cast<nanoseconds>(stop - start).count() / count << "ns";
+
+    start = high_resolution_clock::now();
+    const auto sums = Modular::binomial_power_sums(p, n);
+    stop = high_resolution_clock::now();
+    std::cout << ", binomial_power_sums: " << duration_cast<nanoseconds>(stop - start).count() / count << "ns per prime";
+    std::cout << (check == 0 && sums[count - 1] == 2 * n[count - 1] * p[count - 1] % (p[count - 1] * p[count - 1]) ? "" : " MISMATCH") << std::endl;
+}
+
+// first index into the solution table that can answer input: odd n leave at most 2*n*p(n), even n at most 2,
+// so every n with 2*n*p_upper(n) <= input is skipped
+int first_candidate_index(unsigned long long input)
+{
+    int lo = 0;
+    int hi = solutions.size();
+    while( lo < hi )
+    {
+        const int mid = (lo + hi + 1) / 2;
+        if( 2 * (unsigned long long)mid * nth_prime_upper_bound(mid) <= input ) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
 }
 
-unsigned long long calc_larger_e10(unsigned long long num)
+// the table grows by batches of n until the running maximum crosses B_EDGE, the n that crosses it is the last entry
+// even n always leave 2, only the odd n need the powers
+void build_solutions()
 {
-    long a = 166412;
-    long b = 5290363;
-    return (a*log2((num)) - b) - 1000;
+    std::vector<uint32_t> built_prime;
+    std::vector<uint64_t> built_remainder, built_max;
+    // the columns are cached one by one and moved out as they are stored, a miss on any of them builds all once
+    bool built = false;
+    auto build = [&]
+    {
+        if( built ) return;
+        built = true;
+        constexpr size_t batch = 1024;
+        std::vector<unsigned long long> batch_primes, odd_primes, odd_n;
+        unsigned long long n = 0;
+        unsigned long long running = 0;
+        auto flush = [&]
+        {
+            const auto remainders = Modular::binomial_power_sums(odd_primes, odd_n);
+            size_t odd = 0;
+            for( const auto prime: batch_primes )
+            {
+                if( running >= B_EDGE ) break;
+                const unsigned long long res = (built_prime.size() + 1) % 2 == 1 ? remainders[odd++] : 2;
+                running = std::max(running, res);
+                built_prime.push_back(prime);
+                built_remainder.push_back(res);
+                built_max.push_back(running);
+            }
+            batch_primes.clear();
+            odd_primes.clear();
+            odd_n.clear();
+        };
+        for( const auto prime: PrimeRange(2, N_MAX) )
+        {
+            batch_primes.push_back(prime);
+            if( ++n % 2 == 1 )
+            {
+                odd_primes.push_back(prime);
+                odd_n.push_back(n);
+            }
+            if( batch_primes.size() == batch ) flush();
+            if( running >= B_EDGE ) break;
+        }
+        flush();
+    };
+    solutions.prime = cached_table<uint32_t>("euler123_prime_by_n", 1, N_MAX, B_EDGE, [&]{ build(); return std::move(built_prime); });
+    solutions.remainder = cached_table<uint64_t>("euler123_remainder_by_n", 1, N_MAX, B_EDGE, [&]{ build(); return std::move(built_remainder); });
+    solutions.running_max = cached_table<uint64_t>("euler123_running_max_by_n", 1, N_MAX, B_EDGE, [&]{ build(); return std::move(built_max); });
+}
+
+// fixed width bit packed column, every value takes as many bits as the largest one needs
+class PackedColumn
+{
+public:
+    PackedColumn() = default;
+
+    template<typename T>
+    explicit PackedColumn(const Table<T>& values) : count(values.size())
+    {
+        uint64_t largest = 0;
+        for( const auto v: values ) largest = std::max<uint64_t>(largest, v);
+        width = largest == 0 ? 1 : 64 - __builtin_clzll(largest);
+        mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+        // one spare word so get can always read the word after the first one
+        words.assign((count * width + 63) / 64 + 1, 0);
+        for( size_t i = 0; i < count; i++ )
+        {
+            const size_t bit = i * width;
+            words[bit / 64] |= (uint64_t)values[i] << (bit % 64);
+            if( bit % 64 + width > 64 ) words[bit / 64 + 1] |= (uint64_t)values[i] >> (64 - bit % 64);
+        }
+    }
+
+    uint64_t operator[](size_t i) const
+    {
+        const size_t bit = i * width;
+        const size_t off = bit % 64;
+        // the second word is shifted in two steps so off = 0 does not shift by 64
+        const uint64_t v = (words[bit / 64] >> off) | ((words[bit / 64 + 1] << 1) << (63 - off));
+        return v & mask;
+    }
+
+    size_t size() const { return count; }
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> words;
+    size_t count = 0;
+    int width = 1;
+    uint64_t mask = 1;
+};
+
+// the solution table with every column bit packed, for callers that keep many tables around
+struct PackedSolutionTable
+{
+    explicit PackedSolutionTable(const SolutionTable& table) : prime(table.prime), remainder(table.remainder), running_max(table.running_max) {}
+
+    PackedColumn prime;
+    PackedColumn remainder;
+    PackedColumn running_max;
+
+    size_t size() const { return prime.size(); }
+    size_t bytes() const { return prime.bytes() + remainder.bytes() + running_max.bytes(); }
+};
+
+// memory of the sparse by prime layout against the dense and the packed table, and ns per random remainder lookup
+void benchmark_solution_table()
+{
+    build_solutions();
+    const PackedSolutionTable packed(solutions);
+    std::cout << "solutions by prime: " << N_MAX * (sizeof(unsigned long) + sizeof(int)) / 1024 << "KB";
+    std::cout << ", by n: " << solutions.bytes() / 1024 << "KB";
+    std::cout << ", packed: " << packed.bytes() / 1024 << "KB for " << solutions.size() << " n" << std::endl;
+
+    constexpr int count = 1000000;
+    std::vector<uint32_t> lookups(count);
+    uint64_t state = XORSHIFT_SEED;
+    for( auto& i: lookups ) i = xorshift64(state) % solutions.size();
+
+    unsigned long long check = 0;
+    auto start = high_resolution_clock::now();
+    for( const auto i: lookups ) check += solutions.remainder[i];
+    auto stop = high_resolution_clock::now();
+    std::cout << "remainder lookup: " << duration_cast<nanoseconds>(stop - start).count() / count << "ns";
+
+    start = high_resolution_clock::now();
+    for( const auto i: lookups ) check -= packed.remainder[i];
+    stop = high_resolution_clock::now();
+    std::cout << ", packed: " << duration_cast<nanoseconds>(stop - start).count() / count << "ns";
+
+    bool same = check == 0;
+    for( size_t i = 0; i < solutions.size() && same; i++ )
+    {
+        same = packed.prime[i] == solutions.prime[i] && packed.remainder[i] == solutions.remainder[i] && packed.running_max[i] == solutions.running_max[i];
+    }
+    std::cout << (same ? "" : " MISMATCH") << std::endl;
+}
+
+// least n whose remainder exceeds a threshold, from the running maximum of the remainders over n
+// kept only at the n that can be answers
+// the answer grows with the threshold, so a batch is sorted once and answered by one sweep over the running maximum
+class ThresholdQueries
+{
+public:
+    void build()
+    {
+        best.clear();
+        // n = 1 leaves 0 and even n leave 2, so n = 2 and the odd n are the only possible answers
+        for( size_t n = 2; n <= solutions.size(); n++ )
+        {
+            if( n == 2 || n % 2 == 1 ) best.push_back(solutions.running_max[n - 1]);
+        }
+        edge = best.back();
+    }
+
+    // answers of many inputs, 0 where no n up to the edge exceeds the input
+    // each input is clamped to the edge and packed with its position below it, the packed keys are radix sorted
+    // and merged with the running maximum, the merge steps through the keys or the maximum without a branch
+    void answer_all(const unsigned long long* inputs, size_t count, int* out) const
+    {
+        constexpr int position_bits = 20;
+        constexpr size_t chunk = 1 << position_bits;
+        constexpr int digit_bits = 11;
+        constexpr size_t digits = 1 << digit_bits;
+        const int passes = (64 - __builtin_clzll(edge) + digit_bits - 1) / digit_bits;
+        std::vector<unsigned long long> keys, sorted;
+        std::vector<uint32_t> start(passes * digits);
+        for( size_t lo = 0; lo < count; lo += chunk )
+        {
+            const size_t size = std::min(count - lo, chunk);
+            keys.resize(size);
+            sorted.resize(size);
+            std::fill(start.begin(), start.end(), 0);
+            for( size_t i = 0; i < size; i++ )
+            {
+                keys[i] = std::min(inputs[lo + i], edge) << position_bits | i;
+                for( int p = 0; p < passes; p++ ) start[p * digits + (keys[i] >> (position_bits + p * digit_bits) & (digits - 1))]++;
+            }
+            for( int p = 0; p < passes; p++ )
+            {
+                uint32_t* at = &start[p * digits];
+                uint32_t sum = 0;
+                for( size_t d = 0; d < digits; d++ ) sum += std::exchange(at[d], sum);
+                const int shift = position_bits + p * digit_bits;
+                for( const auto key: keys ) sorted[at[key >> shift & (digits - 1)]++] = key;
+                keys.swap(sorted);
+            }
+
+            // best ends with the edge, so j stays in range while the inputs are below it, the clamped ones come last
+            size_t i = 0, j = 0;
+            while( i < size && keys[i] >> position_bits < edge )
+            {
+                const bool step = best[j] <= keys[i] >> position_bits;
+                out[lo + (keys[i] & (chunk - 1))] = n_of(j);
+                j += step;
+                i += !step;
+            }
+            for( ; i < size; i++ ) out[lo + (keys[i] & (chunk - 1))] = 0;
+        }
+    }
+
+    // same answer by binary search over the running maximum
+    int answer_reference(unsigned long long input) const
+    {
+        if( input >= edge ) return 0;
+        return n_of(std::upper_bound(best.begin(), best.end(), input) - best.begin());
+    }
+
+private:
+    // entry 0 is n = 2, entry i > 0 is n = 2i+1
+    static int n_of(size_t i)
+    {
+        return i == 0 ? 2 : 2 * i + 1;
+    }
+
+    std::vector<unsigned long long> best;
+    unsigned long long edge = 0;
+};
+
+// T followed by T thresholds on stdin, one n per threshold on stdout, -1 when the threshold is above the edge
+int serve_queries()
+{
+    build_solutions();
+    ThresholdQueries queries;
+    queries.build();
+
+    const auto in = TextIO::read_all(stdin);
+    TextIO::NumberReader reader(in.data(), in.size());
+    unsigned long long T = 0;
+    reader.next(T);
+    std::vector<unsigned long long> inputs;
+    unsigned long long input;
+    while( inputs.size() < T && reader.next(input) ) inputs.push_back(input);
+    std::vector<int> answers(inputs.size());
+    queries.answer_all(inputs.data(), inputs.size(), answers.data());
+
+    TextIO::Writer out;
+    out.reserve(answers.size() * 8);
+    for( const int n: answers )
+    {
+        if( n == 0 )
+        {
+            out.put('-');
+            out.number(1);
+        }
+        else out.number(n);
+        out.put('\n');
+    }
+    out.flush();
+    return 0;
+}
+
+// 1e5 random thresholds answered by the sorted sweep and by binary search
+void benchmark_queries()
+{
+    build_solutions();
+    ThresholdQueries queries;
+    queries.build();
+
+    constexpr int count = 100000;
+    std::vector<unsigned long long> inputs(count);
+    uint64_t state = XORSHIFT_SEED;
+    for( auto& input: inputs ) input = xorshift64(state) % (B_EDGE + 1);
+
+    std::vector<int> answers(count), reference(count);
+    // one warm batch, the first one also pays for faulting in its buffers
+    queries.answer_all(inputs.data(), count, answers.data());
+    auto start = high_resolution_clock::now();
+    queries.answer_all(inputs.data(), count, answers.data());
+    auto stop = high_resolution_clock::now();
+    std::cout << "threshold queries: " << duration_cast<microseconds>(stop - start).count() << "us for " << count;
+
+    start = high_resolution_clock::now();
+    for( int i = 0; i < count; i++ ) reference[i] = queries.answer_reference(inputs[i]);
+    stop = high_resolution_clock::now();
+    std::cout << ", binary search: " << duration_cast<microseconds>(stop - start).count() << "us";
+    std::cout << (answers == reference ? "" : " MISMATCH") << std::endl;
 }
 
 int do_main()
@@ -160,19 +466,8 @@ int do_main()
         inputs[i] = N;
     }*/
 
-    find_primes_to_n();
-    solutions[3] = 2;
-    solution_indices[3] = 2;
-    for( int n = 1; n <= 200000; n+=2 )
-    {
-        unsigned long long res = calc_remainder(n);
-        solutions[ primes[n-1] ] = res;
-        solution_indices[ primes[n-1] ] = n;
-        if( res >= B_EDGE)
-        {
-            break;
-        }
-    }
+    unit_power_tests();
+    build_solutions();
 
     unsigned long factor = 2;
     for(int i = 0; i < 39; i++)
@@ -205,10 +500,9 @@ int do_main()
     std::vector<int> out_to_validate;
     for(const auto& input: inputs)
     {
-        for(int i = 0; i < primes.size(); i++)
+        for(size_t i = 0; i < solutions.size(); i++)
         {
-            const auto prime = primes[i];
-            if( solutions[prime] > input )
+            if( solutions.remainder[i] > input )
             {
                 out_to_validate.push_back(i+1);
                 break;
@@ -219,42 +513,19 @@ int do_main()
     int out_p = 0;
     for(const auto& input: inputs)
     {
-        int i_start = 0;
-        int prime_1eX = 21089;
-        const int thres_eX = 1e8;
-        if( input > thres_eX )
-        {
-            unsigned long start_N = thres_eX;
-            i_start = solution_indices[prime_1eX];
-            while( start_N*22/10 < input)
-            {
-                prime_1eX = (long double)prime_1eX/log(2);
-                start_N *= 2;
-            }
-
-            while( (start_N*130)/100 < input)
-            {
-                prime_1eX = (long double)prime_1eX/log(1.1);
-                prime_1eX /= 10;
-                start_N *= 11;
-                start_N /= 10;
-            }
-
-            while( solutions[prime_1eX] == 0 ) prime_1eX--;
-            i_start = solution_indices[prime_1eX];
-        }
+        const int i_start = first_candidate_index(input);
         auto start = std::chrono::high_resolution_clock::now();
-        for(int i = i_start; i < primes.size(); i++)
+        for(size_t i = i_start; i < solutions.size(); i++)
         {
-            const auto prime = primes[i];
-            if( solutions[prime] > input )
+            const auto prime = solutions.prime[i];
+            if( solutions.remainder[i] > input )
             {
-                std::cout << "found solution at " << prime << "(" << i+1 << ")=" << solutions[prime];
+                std::cout << "found solution at " << prime << "(" << i+1 << ")=" << solutions.remainder[i];
                 std::cout << " started at " << i_start << "(" << (i - i_start) << ")";
-                if( out_p < out_to_validate.size() && out_to_validate[out_p++] == solution_indices[prime] ) std::cout << " PASS" <<std::endl;
+                if( out_p < out_to_validate.size() && out_to_validate[out_p++] == (int)i+1 ) std::cout << " PASS" <<std::endl;
                 else{
                     if( out_p < out_to_validate.size() )
-                    std::cout << " FAIL " << out_to_validate[out_p-1] << " " << solution_indices[prime] <<std::endl;
+                    std::cout << " FAIL " << out_to_validate[out_p-1] << " " << i+1 <<std::endl;
                 }
                 break;
             }
@@ -266,8 +537,16 @@ int do_main()
     return 0;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    if( argc > 1 && std::string(argv[1]) == "bench" )
+    {
+        benchmark_power();
+        benchmark_solution_table();
+        benchmark_queries();
+        return 0;
+    }
+    if( argc > 1 && std::string(argv[1]) == "serve" ) return serve_queries();
     do_main();
     return 0;
 }
\ No newline at end of file
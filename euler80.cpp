@@ -2,211 +2,103 @@
 #include <cmath>
 #include <iostream>
 #include <iomanip>
-#include <map>
+#include <atomic>
+#include <numeric>
 #include <chrono>
 
 #include "BigInt.h"
+#include "ThreadPool.h"
 
 using namespace PositiveBigInt;
 using namespace std::chrono;
 
-#define PRIME_MAX 1000
-
-std::map<int, BigInt> solutions;
-std::vector<int> primes = {2,3,5,7};
-std::vector<int> squares = {};
-
-bool is_prime(long long num) {
-    if(num < 2) return false;
-    for(const auto &val:primes) {
-        if(val > num / val) return true;
-        if(num % val == 0) return false;
-    }
-    return true;
-}
-
-void find_primes_to_n() {
-    for(int i = 9; i < PRIME_MAX; i+=2) {
-        if(is_prime(i)) primes.push_back(i);
-    }
-}
-
-void find_squares_to_n(int N)
+// time of the Newton square root for P decimal places of sqrt(2)
+void benchmark_isqrt()
 {
-    for(int i = 2; i <= N; i++)
+    for( const int P : {100, 1000, 10000, 100000} )
     {
-        const int sq = i*i;
-        squares.push_back( sq );
-        if(sq > N) break;
-    }
-}
-
-bool is_perfect( int n )
-{
-    int sq_rt = sqrt(n);
-    return sq_rt * sq_rt == n;
-}
-
-BigInt* get_value_from_solutions(int num)
-{
-    auto pos = solutions.find(num);
-    if (pos != solutions.end()) {
-        return &pos->second;
+        auto start = high_resolution_clock::now();
+        const BigInt root = BigInt(2).isqrt(P);
+        auto stop = high_resolution_clock::now();
+        std::cout << "isqrt(2, " << P << "): " << duration_cast<microseconds>(stop - start).count() << "mus";
+        start = high_resolution_clock::now();
+        const int digit_sum = root.get_digit_sum(P);
+        stop = high_resolution_clock::now();
+        std::cout << ", digit sum " << digit_sum << " in " << duration_cast<microseconds>(stop - start).count() << "mus" << std::endl;
     }
-    return nullptr;
 }
 
-std::pair<int,int> get_square_factor( int n )
+// digit sums of the first P digits of sqrt(i) for every i <= N, indexed by i and 0 for perfect squares
+// square free roots are spread over the pool, each one then fans out into its multiples
+// a*k^2 as k*sqrt(a) and is dropped once the last of them has been summed
+std::vector<int> sqrt_digit_sums(int N, int P, ThreadPool& pool)
 {
-    std::pair<int,int> res = std::make_pair(-1,-1);
-    for( const auto& sq: squares )
+    // i = base[i] * factor[i]^2 with base[i] square free
+    std::vector<int> base(N + 1, 0);
+    std::vector<int> factor(N + 1, 0);
+    for( int a = 1; a <= N; a++ )
     {
-        const int div_cache = n / sq;
-        if( div_cache * sq == n )
+        if( base[a] != 0 ) continue;
+        for( int k = 1; a * k * k <= N; k++ )
         {
-            res = std::make_pair(div_cache, sqrt(sq));
+            base[a * k * k] = a;
+            factor[a * k * k] = k;
         }
-        if( div_cache <= 1 ) break;
     }
-    return res;
-}
 
-void sqrt_new(const int target, const int P)
-{
-    int start_num = sqrt( target );
-    BigInt start = BigInt(start_num*start_num);
-    BigInt target_cache(target, 21000 / start.get_threshold_exp(), 22000);
-
-    int old_num = start_num;
-
-    BigInt estimate_factor(0, 10500 / start.get_threshold_exp());
-    BigInt est_factor_cache(old_num,0,50);
-    BigInt estimate_factor_cmpl(0, 10500 / start.get_threshold_exp());
-    uint8_t count_zero = 0;
-    int realP = start_num > 9 ? P - 2: P - 1;
-    int init_duration = 0;
-    bool is_set = false;
-    for(int i = 0; i < realP; i++)
+    std::vector<int> digit_sums(N + 1, 0);
+    std::vector<BigInt> roots(N + 1, BigInt(0));
+    std::vector<std::atomic<int>> pending(N + 1);
+    for( int a = 2; a <= N; a++ )
     {
-        if( target_cache.start_offset == 0 ) throw std::invalid_argument( "received negative value" );
-        // slow, 40ms for P=10000, 15ms for substraction, 9ms for *100, 8ms for *10
-        //auto c_start = high_resolution_clock::now();
-        target_cache -= start;
-        //auto c_stop = high_resolution_clock::now();
-        //auto duration = duration_cast<microseconds>(c_stop - c_start);
-        //init_duration += duration.count();
-        const int target_cache_size = target_cache.get_digit_count();
-        if( is_set || target_cache_size >= 100 )
-        {
-            target_cache.multiply_by_10();
-            target_cache.multiply_by_10();
-            estimate_factor_cmpl.multiply_by_10();
-            is_set = true;
-        }
-        else
-        {
-            target_cache *= 100;
-            estimate_factor_cmpl *= 10;
-        }
-
-        estimate_factor_cmpl += (old_num*20);
-
-        int estimate_num(0);
-
-        if( !is_set && target_cache_size < 100 )
+        if( base[a] != a ) continue;
+        int multiples = 0;
+        while( a * (multiples + 2) * (multiples + 2) <= N ) multiples++;
+        pending[a] = multiples;
+        pool.submit([&, a, multiples]
         {
-            start = ( estimate_factor_cmpl + estimate_num) * estimate_num;
-            while( start < target_cache )
+            // a few guard digits so that the multiples k*sqrt(a) keep their first P digits
+            roots[a] = BigInt(a).isqrt(P + 5);
+            digit_sums[a] = roots[a].get_digit_sum(P);
+            if( multiples == 0 )
             {
-                estimate_num++;
-                start = ( estimate_factor_cmpl + estimate_num) * estimate_num;
+                roots[a] = BigInt(0);
+                return;
             }
-            if( estimate_num > 0 )
+            for( int k = 2; k <= multiples + 1; k++ )
             {
-                estimate_num--;
-                start = ( estimate_factor_cmpl + estimate_num) * estimate_num;
+                pool.submit([&, a, k]
+                {
+                    digit_sums[a * k * k] = (roots[a] * k).get_digit_sum(P);
+                    if( --pending[a] == 0 ) roots[a] = BigInt(0);
+                });
             }
-        }
-        else
-        {
-            BigInt rough_estimate = estimate_factor_cmpl.get_big_int_until(4);
-            BigInt rough_target = target_cache.get_big_int_until(4);
-            const int diff_digit_count = target_cache.get_digit_count() - estimate_factor_cmpl.get_digit_count();
-            int rough_diff_digit_count = rough_target.get_digit_count() - rough_estimate.get_digit_count();
-            while( diff_digit_count < rough_diff_digit_count )
-            {
-                rough_estimate *= 10;
-                rough_diff_digit_count--;
-            }
-            while( diff_digit_count > rough_diff_digit_count )
-            {
-                rough_target *= 10;
-                rough_diff_digit_count++;
-            }
-            BigInt estimated = rough_estimate;
-            estimated *= estimate_num;
-            while( estimated < rough_target )
-            {
-                estimate_num++;
-                estimated = rough_estimate;
-                estimated *= estimate_num;
-            }
-
-            // 7ms in total for P=10000
-            estimate_num--;
-            start = estimate_factor_cmpl;
-            start += estimate_num;
-            start *= estimate_num;
-        }
-
-        // fast, 0.1ms in total for P=10000
-        old_num = estimate_num;
-        est_factor_cache *= 10;
-        est_factor_cache += estimate_num;
-        if( est_factor_cache.num[est_factor_cache.start_offset] == 0 ) count_zero++;
-
-        if( est_factor_cache.get_digit_count() + count_zero == est_factor_cache.get_threshold_exp() )
-        {
-            estimate_factor.start_offset--;
-            estimate_factor += est_factor_cache;
-            est_factor_cache = BigInt(0,0,50);
-            count_zero = 0;
-        }
+        });
     }
-
-    // fast
-    const int total_digits = est_factor_cache.get_digit_count() + count_zero;
-    for( int i = 0; i < total_digits/2; i++ ) estimate_factor *= 100;
-    if( total_digits % 2 == 1 ) estimate_factor *= 10;
-    estimate_factor += est_factor_cache;
-    solutions.insert( {target, estimate_factor});
-    //std::cerr << target << " init took " << init_duration << "mus" << std::endl;
+    pool.wait();
+    return digit_sums;
 }
 
 unsigned long long run_variant(int N, int P)
 {
-    solutions = {};
-    unsigned long long total_sum = 0;
-    for( int i = 2; i <= N; i++ )
-    {
-        if( is_perfect( i ) ) continue;
-        const auto sqf = get_square_factor(i);
-        if( sqf.first != -1 )
-        {
-            auto* val = get_value_from_solutions(sqf.first);
-            BigInt sqrtX = *val;
-            sqrtX *= sqf.second;
-            total_sum += sqrtX.get_digit_sum(P);
-        }
-        else
-        {
-            sqrt_new(i, P+5);
+    const auto digit_sums = sqrt_digit_sums(N, P, shared_pool());
+    return std::accumulate(digit_sums.begin(), digit_sums.end(), 0ULL);
+}
 
-            // 4ms in total
-            total_sum += get_value_from_solutions(i)->get_digit_sum(P);
-        }
+// wall time of the N=1000, P=10000 batch for growing worker counts
+void benchmark_batch()
+{
+    const size_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for( size_t threads = 1; threads <= max_threads; threads *= 2 )
+    {
+        ThreadPool pool(threads);
+        auto start = high_resolution_clock::now();
+        const auto digit_sums = sqrt_digit_sums(1000, 10000, pool);
+        auto stop = high_resolution_clock::now();
+        std::cout << "batch(1000, 10000) on " << threads << " threads: "
+                  << duration_cast<milliseconds>(stop - start).count() << "ms, sum "
+                  << std::accumulate(digit_sums.begin(), digit_sums.end(), 0ULL) << std::endl;
     }
-    return total_sum;
 }
 
 void all_unit_tests()
@@ -217,12 +109,21 @@ void all_unit_tests()
     unit_test_operator(run_variant(1000, 1000) == 4359087, true );
 }
 
-int main()
+int main(int argc, char** argv)
 {
     int N = 10;
     int P = 10000;
-    find_squares_to_n(1000);
-    find_primes_to_n();
+
+    if( argc > 1 && std::string(argv[1]) == "bench" )
+    {
+        benchmark_multiplication();
+        benchmark_throughput();
+        benchmark_allocations();
+        benchmark_division();
+        benchmark_isqrt();
+        benchmark_batch();
+        return 0;
+    }
 
     // std::cout << run_variant(N, P) << std::endl;
 
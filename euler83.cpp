@@ -1,206 +1,254 @@
-#include <array>
+#include <vector>
+#include <string>
 #include <iostream>
 #include <algorithm>
 #include <cstdlib>
+#include <cassert>
+#include <chrono>
 
-constexpr uint8_t UP = 0;
-constexpr uint8_t DOWN = 1;
-constexpr uint8_t LEFT = 2;
-constexpr uint8_t RIGHT = 3;
+#include "GridPath.h"
+#include "Random.h"
+
+using namespace std::chrono;
 
 constexpr uint16_t N_MAX = 700;
 
-class Node;
-std::array<std::array<Node*, N_MAX>, N_MAX> nodes = {};
-std::vector<Node*> leaf_nodes = {};
-std::vector<Node*> leaf_nodes_new = {};
-std::array<std::array<long, N_MAX>, N_MAX> values = {};
-std::array<std::array<long, N_MAX>, N_MAX> min_sums = {};
+Grid<long> field;
 
-class Node
+// cheapest path from the top left to the bottom right cell, with 32 bit distances while every path sum fits
+template<typename Cost>
+uint64_t min_path_sum(const Grid<Cost>& grid)
 {
-    public:
-        Node(uint16_t x, uint16_t y, uint16_t N, Node* parent) : x(x), y(y), N(N), parent(parent)
-        {
-        }
-        ~Node()
-        {
-            for( auto*& p : leaf_nodes )
-            {
-                if( p == this )
-                {
-                    p = nullptr;
-                    break;
-                }
-            }
-            for( auto*& p : leaf_nodes_new )
-            {
-                if( p == this )
-                {
-                    p = nullptr;
-                    break;
-                }
-            }
-            nodes[y][x] = nullptr;
-            if( parent != nullptr )
-            {
-                if( parent->down == this ) parent->down = nullptr;
-                else if( parent->up == this ) parent->up = nullptr;
-                else if( parent->left == this ) parent->left = nullptr;
-                else if( parent->right == this ) parent->right = nullptr;
-            }
-            delete_children();
-        }
+    const uint64_t largest = *std::max_element(grid.cells.begin(), grid.cells.end());
+    if( largest <= (std::numeric_limits<uint32_t>::max() - 1) / grid.cells.size() )
+    {
+        GridShortestPath<Cost, uint32_t> path;
+        return path.solve(grid.cells.data(), grid.rows, grid.cols, 0, grid.cells.size() - 1);
+    }
+    GridShortestPath<Cost> path;
+    return path.solve(grid.cells.data(), grid.rows, grid.cols, 0, grid.cells.size() - 1);
+}
 
-        void walk()
-        {
-            if( x == N - 1 && y == N - 1 )
-            {
-                // std::cout << "Found end " << min_sums[y][x] << std::endl;
-                return;
-            }
-
-            if( y < N - 1 )
-            {
-                new_node( x, y + 1, down);
-            }
-            if( y > 0 )
-            {
-                new_node( x, y - 1, up);
-            }
-            if( x > 0 )
-            {
-                new_node( x - 1 , y, left);
-            }
-            if( x < N - 1 )
-            {
-                new_node( x + 1 , y, right);
-            }
-        }
+void unit_path_test(const std::vector<std::vector<long>>& vals, uint64_t expected)
+{
+    const int N = vals.size();
+    field.rows = N;
+    field.cols = N;
+    field.cells.clear();
+    for( const auto& row: vals ) field.cells.insert(field.cells.end(), row.begin(), row.end());
+    std::cout << "TEST: " << N << "x" << N << "=";
+    auto res = min_path_sum(field);
+    std::cout << res << " and expected: " << expected << std::endl;
+    assert( res == expected );
+}
 
-        uint16_t x;
-        uint16_t y;
-        uint16_t N;
-        Node* parent;
-    private:
-        void delete_children()
-        {
-            if( down )
-            {
-                down->parent = nullptr;
-                delete down;
-            }
-            if( up )
-            {
-                up->parent = nullptr;
-                delete up;
-            }
-            if( left )
-            {
-                left->parent = nullptr;
-                delete left;
-            }
-            if( right )
-            {
-                right->parent = nullptr;
-                delete right;
-            }
-        }
+void unit_path_tests()
+{
+    unit_path_test({
+        {131, 673, 234, 103, 18},
+        {201, 96, 342, 965, 150},
+        {630, 803, 746, 422, 111},
+        {537, 699, 497, 121, 956},
+        {805, 732, 524, 37, 331},
+    }, 2297);
+    unit_path_test({{7}}, 7);
+    unit_path_test({{1, 9}, {1, 1}}, 3);
+    // the cheapest path has to go up and left again
+    unit_path_test({
+        {1, 1, 1, 1, 1},
+        {9, 9, 9, 9, 1},
+        {1, 1, 1, 9, 1},
+        {1, 9, 1, 9, 1},
+        {1, 9, 1, 1, 1},
+    }, 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1);
+}
 
-        void new_node(uint16_t x_, uint16_t y_, Node*& node)
-        {
-            if( x_ == 0 && y_ == 0 ) return;
-
-            auto& min_sumsxy = min_sums[y_][x_];
-            if( min_sumsxy == 0 || ( values[y_][x_] + min_sums[y][x] < min_sumsxy )  )
-            {
-                if( min_sumsxy != 0 )
-                {
-                    auto* n = nodes[y_][x_];
-                    if( n ) delete n;
-                }
-                min_sumsxy = values[y_][x_] + min_sums[y][x];
-                node = new Node(x_, y_, N, this);
-                if( std::find(leaf_nodes_new.begin(), leaf_nodes_new.end(), node) == leaf_nodes_new.end() ) leaf_nodes_new.push_back(node);
-                nodes[y_][x_] = node;
-            }
-        }
+// ms per solve of Dial's queue and of the 4-ary heap on random single digit grids; every cell gets settled, so
+// a 5000x5000 grid takes seconds on one core (about 2s with Dial, 7-10s with the heap), not milliseconds
+void benchmark_path(int N)
+{
+    std::vector<uint8_t> grid(N * N);
+    uint64_t state = XORSHIFT_SEED;
+    for( auto& cell: grid ) cell = xorshift64(state) % 10;
 
-        Node* down = nullptr;
-        Node* up = nullptr;
-        Node* left = nullptr;
-        Node* right = nullptr;
-};
+    GridShortestPath<uint8_t, uint32_t> path;
+    auto start = high_resolution_clock::now();
+    const auto dial = path.solve(grid.data(), N, N, 0, grid.size() - 1);
+    auto stop = high_resolution_clock::now();
+    std::cout << N << "x" << N << " dial: " << duration_cast<milliseconds>(stop - start).count() << "ms";
+
+    start = high_resolution_clock::now();
+    const auto heap = path.query_heap(0, grid.size() - 1);
+    stop = high_resolution_clock::now();
+    std::cout << ", heap: " << duration_cast<milliseconds>(stop - start).count() << "ms";
+    std::cout << " " << dial << (dial == heap ? "" : " MISMATCH") << std::endl;
+}
 
-class Root
+// the euler81 and euler82 example answers through their move sets
+void unit_move_tests()
 {
-    public:
-        Root(uint16_t N)
-        {
-            Node* down = new Node(0, 1, N, nullptr);
-            Node* right = new Node(1, 0, N, nullptr);
-            leaf_nodes_new.push_back(down);
-            leaf_nodes_new.push_back(right);
-            min_sums[1][0] = values[0][0] + values[1][0];
-            nodes[1][0] = down;
-            min_sums[0][1] = values[0][0] + values[0][1];
-            nodes[0][1] = right;
-
-            while( leaf_nodes_new.size() )
-            {
-                leaf_nodes = leaf_nodes_new;
-                // std::cerr << leaf_nodes.size() << std::endl;
-                leaf_nodes_new.clear();
-                for( auto* c : leaf_nodes )
-                {
-                    if( c )
-                    {
-                        c->walk();
-                    }
-                }
-            }
-        }
-};
+    const std::vector<long> example = {
+        131, 673, 234, 103, 18,
+        201, 96, 342, 965, 150,
+        630, 803, 746, 422, 111,
+        537, 699, 497, 121, 956,
+        805, 732, 524, 37, 331,
+    };
+    GridShortestPath<long, uint64_t, GridMoves::RightDown> right_down(example.data(), 5, 5);
+    std::cout << "TEST: right and down=" << right_down.query(0, 24) << " and expected: 2427" << std::endl;
+    assert( right_down.query(0, 24) == 2427 );
+    assert( right_down.query(24, 0) == GridShortestPath<long>::unreached );
+
+    // any cell of the left column to any cell of the right column
+    GridShortestPath<long, uint64_t, GridMoves::UpDownRight> up_down_right(example.data(), 5, 5);
+    std::vector<std::pair<size_t, size_t>> pairs;
+    for( size_t from = 0; from < 5; from++ )
+    {
+        for( size_t to = 0; to < 5; to++ ) pairs.push_back({from * 5, to * 5 + 4});
+    }
+    const auto sums = up_down_right.queries(pairs);
+    const auto best = *std::min_element(sums.begin(), sums.end());
+    std::cout << "TEST: up, down and right=" << best << " and expected: 994" << std::endl;
+    assert( best == 994 );
+
+    GridShortestPath<long> four_way(example.data(), 5, 5);
+    assert( four_way.query(0, 24) == 2297 && four_way.query(24, 0) == 2297 && four_way.query(12, 12) == 746 );
+}
 
-void create_random_field( int N )
+// shape and path sum of a matrix given as text, the largest value picks the cost type
+void unit_load_test(const std::string& text, size_t rows, size_t cols, size_t cost_width, uint64_t expected)
 {
-	// Providing a seed value
-	srand((unsigned) time(NULL));
+    std::cout << "TEST: load " << rows << "x" << cols << "=";
+    size_t r = 0, c = 0, width = 0;
+    uint64_t res = 0;
+    const bool ok = load_grid(GridLoad::Text{text.data(), text.size()}, [&](const auto& grid)
+    {
+        r = grid.rows;
+        c = grid.cols;
+        width = sizeof(grid.cells[0]);
+        res = min_path_sum(grid);
+    });
+    std::cout << res << " and expected: " << expected << std::endl;
+    assert( ok && r == rows && c == cols && width == cost_width && res == expected );
+}
+
+void unit_load_tests()
+{
+    unit_load_test("131,673,234,103,18\n201,96,342,965,150\n630,803,746,422,111\n537,699,497,121,956\n805,732,524,37,331\n", 5, 5, 2, 2297);
+    unit_load_test("70000 1\n1 4294967296\n", 2, 2, 8, 70000 + 1 + 4294967296ULL);
+    unit_load_test("1 2 3\r\n4 5 6\r\n", 2, 3, 1, 12);
+    unit_load_test("\n7\t9\n\n1\t1", 2, 2, 1, 9);
+    size_t r, c;
+    uint64_t largest;
+    assert( !GridLoad::scan("1,2\n3\n", 6, r, c, largest) );
+    assert( !GridLoad::scan("1,-2\n", 5, r, c, largest) );
+    assert( !GridLoad::scan(" \n", 2, r, c, largest) );
+}
 
+// 1000 queries on a random 1000x1000 grid: short hops with the epoch reset against a full reset per query,
+// and pairs from 10 sources answered one by one, extrapolated from the first 100, against one search per source
+void benchmark_queries()
+{
+    constexpr int N = 1000;
+    constexpr int count = 1000;
+    std::vector<uint8_t> grid(N * N);
+    uint64_t state = XORSHIFT_SEED;
+    for( auto& cell: grid ) cell = xorshift64(state) % 10;
+
+    std::vector<std::pair<size_t, size_t>> hops, pairs;
+    for( int i = 0; i < count; i++ )
+    {
+        const size_t r = xorshift64(state) % (N - 32);
+        const size_t c = xorshift64(state) % (N - 32);
+        hops.push_back({r * N + c, (r + xorshift64(state) % 32) * N + c + xorshift64(state) % 32});
+        pairs.push_back({(size_t)(i % 10) * (N * N / 10), xorshift64(state) % (N * N)});
+    }
+
+    GridShortestPath<uint8_t, uint32_t> path(grid.data(), N, N);
+    uint64_t check = 0;
+    auto start = high_resolution_clock::now();
+    for( const auto& hop: hops ) check += path.query(hop.first, hop.second);
+    auto stop = high_resolution_clock::now();
+    std::cout << count << " hops: " << duration_cast<microseconds>(stop - start).count() << "us";
+
+    start = high_resolution_clock::now();
+    for( const auto& hop: hops ) check -= path.solve(grid.data(), N, N, hop.first, hop.second);
+    stop = high_resolution_clock::now();
+    std::cout << ", with a full reset: " << duration_cast<microseconds>(stop - start).count() << "us" << (check == 0 ? "" : " MISMATCH") << std::endl;
+
+    // one by one only for the first tenth, a search per pair from a far source covers most of the grid
+    start = high_resolution_clock::now();
+    std::vector<uint32_t> single;
+    for( int i = 0; i < count / 10; i++ ) single.push_back(path.query(pairs[i].first, pairs[i].second));
+    stop = high_resolution_clock::now();
+    std::cout << count << " pairs from 10 sources: " << duration_cast<milliseconds>(stop - start).count() * 10 << "ms one by one";
+
+    start = high_resolution_clock::now();
+    const auto batched = path.queries(pairs);
+    stop = high_resolution_clock::now();
+    std::cout << ", batched: " << duration_cast<milliseconds>(stop - start).count() << "ms";
+    std::cout << (std::equal(single.begin(), single.end(), batched.begin()) ? "" : " MISMATCH") << std::endl;
+}
+
+// MB/s of scanning and parsing a random single digit csv matrix
+void benchmark_load(int N)
+{
+    std::string text;
+    text.reserve(2 * N * N);
+    uint64_t state = XORSHIFT_SEED;
     for( int i = 0; i < N; i++ )
     {
-        auto& valsi = values[i];
-        for(int j = 0; j < N; j++ )
+        for( int j = 0; j < N; j++ )
         {
-            valsi[j] = rand() % 10;
-            // std::cout << valsi[j] << " ";
+            text.push_back('0' + xorshift64(state) % 10);
+            text.push_back(j + 1 < N ? ',' : '\n');
         }
-        // std::cout << std::endl;
     }
+
+    auto start = high_resolution_clock::now();
+    size_t rows, cols;
+    uint64_t largest;
+    const bool ok = GridLoad::scan(text.data(), text.size(), rows, cols, largest);
+    Grid<uint8_t> grid;
+    grid.rows = rows;
+    grid.cols = cols;
+    grid.cells.resize(rows * cols);
+    GridLoad::parse(text.data(), text.size(), grid.cells.data());
+    auto stop = high_resolution_clock::now();
+    const auto us = duration_cast<microseconds>(stop - start).count();
+    std::cout << N << "x" << N << " load: " << us / 1000 << "ms, " << text.size() / std::max<long long>(us, 1) << "MB/s";
+    std::cout << (ok && rows == (size_t)N && cols == (size_t)N && grid.cells.back() == (uint8_t)(text[text.size() - 2] - '0') ? "" : " MISMATCH") << std::endl;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    const int N = 5;
-    /*std::vector<std::vector<int>> vals = {
-        {131, 673, 234, 103, 18},
-        {201, 96, 342, 965, 150},
-        {630, 803, 746, 422, 111},
-        {537, 699, 497, 121, 956},
-        {805, 732, 524, 37, 331},
-    };
-    for( int i = 0; i < N; i++ )
+    if( argc > 1 && std::string(argv[1]) == "bench" )
     {
-        auto& valsi = values[i];
-        for(int j = 0; j < N; j++ )
+        benchmark_path(N_MAX);
+        benchmark_path(5000);
+        benchmark_queries();
+        benchmark_load(5000);
+        return 0;
+    }
+    // a matrix file, or - for stdin, with one row per line
+    if( argc > 1 )
+    {
+        const bool loaded = load_grid(argv[1], [](const auto& grid)
         {
-            valsi[j] = vals[i][j];
-            std::cout << valsi[j] << " ";
-        }
-        std::cout << std::endl;
-    }*/
-    //create_random_field(N);
-    Root r(N);
-    std::cout << min_sums[N-1][N-1]<< std::endl;
+            std::cout << min_path_sum(grid) << std::endl;
+        });
+        if( !loaded ) std::cerr << "could not read a matrix from " << argv[1] << std::endl;
+        return loaded ? 0 : 1;
+    }
+
+    unit_path_tests();
+    unit_load_tests();
+    unit_move_tests();
+
+    const int N = 5;
+    field.rows = N;
+    field.cols = N;
+    field.cells.assign(N * N, 0);
+    std::cout << min_path_sum(field) << std::endl;
     return 0;
-}
\ No newline at end of file
+}
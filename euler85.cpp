@@ -1,101 +1,345 @@
 #include <vector>
-#include <array>
+#include <algorithm>
+#include <cstdio>
+#include <string>
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+
+#include "ThreadPool.h"
+#include "TextIO.h"
+#include "Random.h"
 
 using namespace std::chrono;
 
-constexpr int N_MAX = 2.1e3;
-constexpr int A_MAX = 2e6;
+// a x by y grid holds T(x)*T(y) rectangles, T(n) = n(n+1)/2
+unsigned long long triangle(unsigned long long n)
+{
+    return n * (n + 1) / 2;
+}
 
-std::array<int, N_MAX> non_trivial_count = {};
-std::array<std::array<int, N_MAX>, N_MAX> rect_counts = {};
+unsigned long long count_rects(int x, int y)
+{
+    return triangle(x) * triangle(y);
+}
 
-int find_non_trivials(int size)
+// the grid whose rectangle count is closest to a target, ties go to the larger area
+struct AreaMatch
 {
-    int sum = 0;
-    for( int i = 1; i < size; i++ ) sum+= size - i;
-    return sum;
+    unsigned long long diff = ~0ULL;
+    unsigned long long area = 0;
+    unsigned long long x = 0;
+    unsigned long long y = 0;
+};
+
+// keeps the better of the current match and x by y for target
+void consider(AreaMatch& best, unsigned long long target, unsigned long long x, unsigned long long y)
+{
+    const unsigned __int128 count = (unsigned __int128)triangle(x) * triangle(y);
+    const unsigned __int128 diff = count > target ? count - target : target - count;
+    if( diff > best.diff ) return;
+    if( diff == best.diff && x * y <= best.area ) return;
+    best.diff = diff;
+    best.area = x * y;
+    best.x = x;
+    best.y = y;
 }
 
-int count_rects(int x, int y)
+// largest y with T(y) <= q, the double estimate is corrected by a step or two
+unsigned long long triangle_root(unsigned long long q)
 {
-    int total_sum = 0;
-    const int x_sum = non_trivial_count[x];
-    const int y_sum = non_trivial_count[y];
-    total_sum += (x*y);
-    total_sum += (x*y_sum);
-    total_sum += (y*x_sum);
-    total_sum += (y_sum*x_sum);
-    return total_sum;
+    unsigned long long y = (std::sqrt(8.0 * q + 1) - 1) / 2;
+    while( y > 0 && triangle(y) > q ) y--;
+    while( triangle(y + 1) <= q ) y++;
+    return y;
 }
 
-int find_area(int rect_count)
+// for every x <= y the counts of the x by y and x by y+1 grids straddle the target when y is the largest
+// side with T(x)*T(y) <= target, so one of them is the best match for this x; x stops once the square
+// x by x alone is further off than the best match, which leaves about target^(1/4) values of x
+AreaMatch closest_area(unsigned long long target)
 {
-    auto start = high_resolution_clock::now();
-    int last_i = 0;
-    int last_j = 0;
-    int last_diff = 1e7;
-    for( int i = 1; i < N_MAX; i++ )
+    AreaMatch best;
+    for( unsigned long long x = 1; ; x++ )
     {
-        const auto rect_count_i = rect_counts[i];
-        const auto diff_ii = rect_count_i[i] - rect_count;
-        if( diff_ii > last_diff ) break;
+        const unsigned __int128 tx = triangle(x);
+        if( tx * tx > target && tx * tx - target > best.diff ) break;
+        const unsigned long long y = triangle_root(target / triangle(x));
+        if( y >= x ) consider(best, target, x, y);
+        consider(best, target, x, std::max(x, y + 1));
+    }
+    return best;
+}
 
-        for( int j = i; j < N_MAX; j++ )
+// one match per target, chunks of targets are answered in parallel
+std::vector<AreaMatch> closest_areas(const std::vector<unsigned long long>& targets)
+{
+    std::vector<AreaMatch> res(targets.size());
+    parallel_for(0, targets.size(), [&](size_t lo, size_t hi)
+    {
+        for( size_t i = lo; i < hi; i++ ) res[i] = closest_area(targets[i]);
+    }, 1 << 12);
+    return res;
+}
+
+// the distinct counts in ascending order, each with the largest area that has it, merged from the rows x <= y;
+// only the current grid of every row is held, row x runs from T(x)^2 to its first count above limit and the
+// rows stop after the first square above limit, so the smallest count above any target up to limit comes out too
+class CountStream
+{
+public:
+    explicit CountStream(unsigned long long limit) : limit(limit)
+    {
+        for( unsigned long long x = 1; ; x++ )
         {
-            const auto rect_count_ij = rect_count_i[j];
-            const auto diff = std::abs(rect_count_ij - rect_count);
-            if( diff == last_diff )
+            rows.push_back({triangle(x) * triangle(x), x, x});
+            if( rows.back().count > limit ) break;
+        }
+        std::make_heap(rows.begin(), rows.end(), later);
+    }
+
+    // next count in diff with its largest grid, false once every row is done
+    bool next(AreaMatch& match)
+    {
+        if( rows.empty() ) return false;
+        match = AreaMatch{};
+        match.diff = rows.front().count;
+        while( !rows.empty() && rows.front().count == match.diff )
+        {
+            std::pop_heap(rows.begin(), rows.end(), later);
+            Row& row = rows.back();
+            if( row.x * row.y > match.area )
             {
-                if( i * j > last_i * last_j )
-                {
-                    std::cout << "found " << diff << " at " << i << ", " << j << std::endl; 
-                    last_i = i;
-                    last_j = j;
-                }
+                match.area = row.x * row.y;
+                match.x = row.x;
+                match.y = row.y;
             }
-            else if( diff < last_diff )
+            if( row.count > limit ) rows.pop_back();
+            else
             {
-                std::cout << "found " << diff << " at " << i << ", " << j << std::endl; 
-                last_i = i;
-                last_j = j;
-                last_diff = diff;
+                row.y++;
+                row.count = triangle(row.x) * triangle(row.y);
+                std::push_heap(rows.begin(), rows.end(), later);
             }
-            if( rect_count_ij > rect_count ) break;
         }
+        return true;
+    }
+
+private:
+    struct Row
+    {
+        unsigned long long count;
+        unsigned long long x;
+        unsigned long long y;
+    };
+
+    static bool later(const Row& a, const Row& b)
+    {
+        return a.count > b.count;
+    }
+
+    unsigned long long limit;
+    std::vector<Row> rows;
+};
+
+// number of grids CountStream merges for limit, about sqrt(2 limit) ln(limit) / 4
+unsigned long long distinct_counts_size(unsigned long long limit)
+{
+    unsigned long long size = 0;
+    for( unsigned long long x = 1; ; x++ )
+    {
+        const unsigned long long y = triangle_root(limit / triangle(x));
+        size += y >= x ? y - x + 2 : 1;
+        if( triangle(x) * triangle(x) > limit ) break;
+    }
+    return size;
+}
+
+// all targets at once: the targets are sorted and swept against the streamed distinct counts, each one takes the
+// closer of the last count at or below it and the first count above it, ties go to the larger area;
+// memory stays at the targets plus one grid per row, but past a few million merged grids (or four per
+// target) the merge takes longer than answering the targets one by one
+std::vector<AreaMatch> closest_areas_offline(const std::vector<unsigned long long>& targets)
+{
+    if( targets.empty() ) return {};
+    const unsigned long long limit = *std::max_element(targets.begin(), targets.end());
+    if( distinct_counts_size(limit) > std::max<unsigned long long>(1 << 22, 4 * targets.size()) ) return closest_areas(targets);
+    CountStream counts(limit);
+
+    std::vector<uint32_t> order(targets.size());
+    for( size_t i = 0; i < order.size(); i++ ) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return targets[a] < targets[b]; });
+
+    std::vector<AreaMatch> res(targets.size());
+    // last count at or below and first count above the current target, x = 0 while there is none
+    AreaMatch below, above;
+    if( !counts.next(above) ) above = AreaMatch{};
+    for( const auto i: order )
+    {
+        const unsigned long long target = targets[i];
+        while( above.x > 0 && above.diff <= target )
+        {
+            below = above;
+            if( !counts.next(above) ) above = AreaMatch{};
+        }
+        AreaMatch best;
+        if( below.x > 0 ) consider(best, target, below.x, below.y);
+        if( above.x > 0 ) consider(best, target, above.x, above.y);
+        res[i] = best;
     }
+    return res;
+}
+
+int find_area(int rect_count)
+{
+    auto start = high_resolution_clock::now();
+    const auto best = closest_area(rect_count);
+    std::cout << "found " << best.diff << " at " << best.x << ", " << best.y << std::endl;
     auto stop = high_resolution_clock::now();
     std::cout << "Took " << duration_cast<microseconds>(stop - start).count() << "mus." << std::endl;
-    return last_i * last_j;
+    return best.area;
 }
 
-int main()
+// the row by row scan over every x <= y that the rect_counts table used to serve, kept as reference
+AreaMatch find_area_reference(unsigned long long rect_count)
 {
-    for(int i = 1; i < N_MAX; i++) non_trivial_count[i] = find_non_trivials(i);
-    for( int i = 1; i < N_MAX; i++ )
+    AreaMatch best;
+    for( unsigned long long i = 1; ; i++ )
     {
-        auto & rect_count_i = rect_counts[i];
-        for( int j = 1; j < N_MAX; j++ )
+        const unsigned long long count_ii = count_rects(i, i);
+        if( count_ii > rect_count && count_ii - rect_count > best.diff ) break;
+        for( unsigned long long j = i; ; j++ )
         {
-            auto& rect_count_ij = rect_count_i[j];
-            if( rect_count_ij != 0 ) continue;
-            rect_count_ij = count_rects(i,j);
-            if( rect_count_ij > A_MAX ) break;
-            if( i != j ) rect_counts[j][i] = rect_count_ij;
+            consider(best, rect_count, i, j);
+            if( count_rects(i, j) > rect_count ) break;
         }
     }
-    /*std::cout << rect_counts[1][1] << std::endl;
-    std::cout << rect_counts[1][2] << std::endl;
-    std::cout << rect_counts[1][3] << std::endl;
-    std::cout << rect_counts[3][2] << std::endl;
-    std::cout << rect_counts[2][1] << std::endl;
-    std::cout << rect_counts[3][3] << std::endl;
-    std::cout << rect_counts[4][1] << std::endl;
-    std::cout << rect_counts[4][3] << std::endl;*/
+    return best;
+}
+
+// every target up to 20000 and random ones up to 2e6 against the reference, then targets far beyond int
+void unit_area_tests()
+{
+    std::vector<unsigned long long> targets;
+    for( unsigned long long t = 1; t <= 20000; t++ ) targets.push_back(t);
+    uint64_t state = XORSHIFT_SEED;
+    for( int i = 0; i < 20000; i++ ) targets.push_back(1 + xorshift64(state) % 2000000);
+    targets.push_back(0);
+    const auto matches = closest_areas(targets);
+    const auto offline = closest_areas_offline(targets);
+    int failed = 0;
+    for( size_t i = 0; i < targets.size(); i++ )
+    {
+        const auto ref = find_area_reference(targets[i]);
+        if( matches[i].diff != ref.diff || matches[i].area != ref.area ) failed++;
+        if( offline[i].diff != ref.diff || offline[i].area != ref.area ) failed++;
+    }
+    std::cout << "TEST: " << targets.size() << " targets against the scan, " << failed << " failed" << std::endl;
+    assert( failed == 0 );
+
+    // project euler 85
+    std::cout << "TEST: 2000000=" << closest_area(2000000).area << " and expected: 2772" << std::endl;
+    assert( closest_area(2000000).area == 2772 );
+    for( const unsigned long long target: {1000000000000ULL, 3141592653589ULL} )
+    {
+        const auto best = closest_area(target);
+        const auto ref = find_area_reference(target);
+        std::cout << "TEST: " << target << "=" << best.area << " and expected: " << ref.area << std::endl;
+        assert( best.diff == ref.diff && best.area == ref.area );
+    }
+}
+
+// ns per target of the descent and of the reference scan
+void benchmark_area()
+{
+    constexpr int count = 100000;
+    std::vector<unsigned long long> targets(count);
+    uint64_t state = XORSHIFT_SEED;
+    for( auto& target: targets ) target = 1 + xorshift64(state) % 2000000;
+
+    std::vector<unsigned long long> areas;
+    auto start = high_resolution_clock::now();
+    for( const auto target: targets ) areas.push_back(closest_area(target).area);
+    auto stop = high_resolution_clock::now();
+    std::cout << "closest_area: " << duration_cast<nanoseconds>(stop - start).count() / count << "ns";
+
+    // the scan only over the first hundredth of the targets
+    bool same = true;
+    start = high_resolution_clock::now();
+    for( int i = 0; i < count / 100; i++ ) same = find_area_reference(targets[i]).area == areas[i] && same;
+    stop = high_resolution_clock::now();
+    std::cout << ", reference scan: " << duration_cast<nanoseconds>(stop - start).count() / (count / 100) << "ns per target";
+    std::cout << (same ? "" : " MISMATCH") << std::endl;
+}
+
+// queries per second of the offline sweep against closest_area and the reference scan, answering T targets up to max
+void benchmark_offline(int count, unsigned long long max)
+{
+    std::vector<unsigned long long> targets(count);
+    uint64_t state = XORSHIFT_SEED;
+    for( auto& target: targets ) target = 1 + xorshift64(state) % max;
+
+    auto start = high_resolution_clock::now();
+    const auto offline = closest_areas_offline(targets);
+    auto stop = high_resolution_clock::now();
+    auto per_second = [&](int n){ return (long long)(n * 1e9 / std::max<long long>(duration_cast<nanoseconds>(stop - start).count(), 1)); };
+    std::cout << count << " targets up to " << max << ", offline: " << per_second(count) << "/s";
+
+    bool same = true;
+    start = high_resolution_clock::now();
+    for( int i = 0; i < count; i++ ) same = closest_area(targets[i]).area == offline[i].area && same;
+    stop = high_resolution_clock::now();
+    std::cout << ", closest_area: " << per_second(count) << "/s";
+
+    // the scan only over the first 20 targets, it takes tens of ms per target near 1e12
+    const int sampled = std::min(count, 20);
+    start = high_resolution_clock::now();
+    for( int i = 0; i < sampled; i++ ) same = find_area_reference(targets[i]).area == offline[i].area && same;
+    stop = high_resolution_clock::now();
+    std::cout << ", reference scan: " << per_second(sampled) << "/s" << (same ? "" : " MISMATCH") << std::endl;
+}
+
+// T followed by T targets on stdin, the area of the closest grid for each on stdout
+int serve_areas()
+{
+    const auto in = TextIO::read_all(stdin);
+    TextIO::NumberReader reader(in.data(), in.size());
+    unsigned long long T = 0;
+    reader.next(T);
+    std::vector<unsigned long long> targets;
+    unsigned long long target;
+    while( targets.size() < T && reader.next(target) ) targets.push_back(target);
+    const auto matches = closest_areas_offline(targets);
+
+    TextIO::Writer out;
+    out.reserve(matches.size() * 8);
+    for( const auto& match: matches )
+    {
+        out.number(match.area);
+        out.put('\n');
+    }
+    out.flush();
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if( argc > 1 && std::string(argv[1]) == "bench" )
+    {
+        unit_area_tests();
+        benchmark_area();
+        benchmark_offline(10000, 2000000);
+        benchmark_offline(1000000, 2000000);
+        benchmark_offline(100000, 1000000000000ULL);
+        return 0;
+    }
+    if( argc > 1 && std::string(argv[1]) == "serve" ) return serve_areas();
     std::cout << find_area(18) << std::endl;
     std::cout << find_area(2) << std::endl;
     // std::cout << find_area(1e6) << std::endl;
     std::cout << find_area(60) << std::endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -3,83 +3,60 @@
 #include <iostream>
 #include <math.h>
 #include <algorithm>
+#include <string>
+#include <chrono>
+#include <cassert>
+#include "Primes.h"
+
+using namespace std::chrono;
 
 constexpr int PRIME_MAX = 5e5;
 constexpr int N_MAX = 2.1e5;
 constexpr uint8_t N_LOG2_MAX = 20;
-constexpr uint8_t MAX_SUMS = 150;
+constexpr int K_MAX = 2e5;
 
-const std::vector<int> primes_single_digit = {2,3,5,7};
 const std::vector<int> factors_single_digits = {2,3,4,5,6,7,8,9};
-std::vector<int> primes = primes_single_digit;
-std::array<bool, PRIME_MAX> b_is_prime = {};
-std::array<std::array<int, N_LOG2_MAX>, N_MAX> prime_factors = {{}};
-std::array<std::array<int, N_LOG2_MAX>, N_MAX> prime_factors_with_duplicates = {{}};
-std::array<std::array<int, MAX_SUMS>, N_MAX> sums = {{}};
-
-bool is_prime(unsigned long long num) {
-    if(num < 2) return false;
-    for(const auto &val:primes) {
-        if(val > num / val) return true;
-        if(num % val == 0) return false;
-    }
-    return true;
-}
+using FactorList = std::array<int, N_LOG2_MAX>;
+Table<FactorList> prime_factors;
+Table<FactorList> prime_factors_with_duplicates;
 
-void find_primes_to_n() {
-    for(unsigned long long i = 9; i < PRIME_MAX; i+=2) {
-        if(is_prime(i)) primes.push_back(i);
-    }
-    for( const auto&p : primes ) b_is_prime[p] = true;
-}
-
-template<size_t N>
-bool is_in_array(const std::array<int, N>& arr, int num)
+// distinct and repeated prime factors of num, both zero terminated
+void find_prime_factors(const int num, FactorList& factors, FactorList& factors_with_dupl)
 {
-    for( const auto& a: arr )
+    int offset = 0;
+    int offset_dupl = 0;
+    for( const auto& f: smallest_prime_factors.factorize(num) )
     {
-        if( a == num ) return true;
-        if( a == 0 ) break;
+        factors[offset++] = f.prime;
+        for( uint32_t e = 0; e < f.exponent; e++ ) factors_with_dupl[offset_dupl++] = f.prime;
     }
-    return false;
+
+    factors_with_dupl[offset_dupl] = 0;
+    factors[offset] = 0;
 }
 
-std::array<int, N_LOG2_MAX> find_prime_factors(const int num)
+// factor lists of every composite below N_MAX, primes keep empty lists
+void build_factor_tables()
 {
-    std::array<int, N_LOG2_MAX> factors;
-    auto& factors_with_dupl = prime_factors_with_duplicates[num];
-    int offset = 0;
-    int offset_dupl = 0;
-    int n = num;
-    while( n > 1 )
+    std::vector<FactorList> distinct;
+    std::vector<FactorList> repeated;
+    auto build = [&]
     {
-        if( b_is_prime[ n ] )
-        {
-            if( offset == 0 || factors[offset - 1] != n )
-            {
-                factors[offset++] = n;
-            }
-            factors_with_dupl[offset_dupl++] = n;
-            break;
-        }
-        for( const auto& p: primes )
+        if( !distinct.empty() ) return;
+        smallest_prime_factors.build(N_MAX);
+        distinct.assign(N_MAX, FactorList{});
+        repeated.assign(N_MAX, FactorList{});
+        parallel_for(2, N_MAX, [&](size_t lo, size_t hi)
         {
-            if( n % p == 0 )
+            for( size_t i = lo; i < hi; i++ )
             {
-                if( offset == 0 || factors[offset - 1] != p )
-                {
-                    factors[offset++] = p;
-                }
-                factors_with_dupl[offset_dupl++] = p;
-                n /=p;
-                break;
+                if( b_is_prime[i] ) continue;
+                find_prime_factors( i, distinct[i], repeated[i] );
             }
-        }
-    }
-
-    factors_with_dupl[offset_dupl] = 0;
-    factors[offset] = 0;
-    return factors;
+        });
+    };
+    prime_factors = cached_table<FactorList>("euler88_prime_factors", 1, N_MAX, 0, [&]{ build(); return std::move(distinct); });
+    prime_factors_with_duplicates = cached_table<FactorList>("euler88_prime_factors_with_duplicates", 1, N_MAX, 0, [&]{ build(); return std::move(repeated); });
 }
 
 int get_min_sum(int num)
@@ -131,29 +108,58 @@ bool check_product_sum( const int& num, const int& target_product, const int& su
     return false;
 }
 
-bool check_product_sum( const int num, const int& start_sum)
+// factors >= start appended to a multiset with product p, sum s and count factors, every multiset of two
+// or more factors padded with p - s ones is a product-sum number for k = p - s + count
+// adding a factor f raises k by (p-1)(f-1), so a branch stops once k passes kmax
+void extend_product_sums(uint64_t p, uint64_t s, uint32_t count, uint64_t start, uint32_t kmax, std::vector<uint32_t>& best)
 {
-    // std::cout << num << " - " << product << " - " << sum << std::endl;
-    return is_in_array( sums[num], num - start_sum );
+    for( uint64_t f = start; p * f <= 2ULL * kmax; f++ )
+    {
+        const uint64_t np = p * f;
+        const uint64_t ns = s + f;
+        const uint64_t k = np - ns + count + 1;
+        if( k > kmax ) break;
+        if( count + 1 >= 2 && np < best[k] ) best[k] = np;
+        extend_product_sums(np, ns, count + 1, f, kmax, best);
+    }
+}
+
+// minimal product-sum number of every k up to kmax from one walk over the non decreasing factor lists,
+// products stay at most 2 kmax since 2 * k with k - 2 ones is a product-sum number for k
+std::vector<uint32_t> minimal_product_sums(uint32_t kmax)
+{
+    std::vector<uint32_t> best(kmax + 1, ~0u);
+    extend_product_sums(1, 0, 0, 2, kmax, best);
+    return best;
 }
 
-int main()
+// sum of the distinct minimal product-sum numbers for 2 <= k <= kmax
+unsigned long product_sum_total(uint32_t kmax)
 {
-    int N = 12;
-    find_primes_to_n();
-    int count_nums = 0;
-    for( int i = 2; i < N_MAX; i++ )
+    const auto best = minimal_product_sums(kmax);
+    std::vector<bool> seen(2 * kmax + 1);
+    unsigned long total_sum = 0;
+    for( uint32_t k = 2; k <= kmax; k++ )
     {
-        if( b_is_prime[i] ) continue;
-        prime_factors[i] = find_prime_factors( i );
+        if( seen[best[k]] ) continue;
+        seen[best[k]] = true;
+        total_sum += best[k];
     }
+    return total_sum;
+}
+
+// the search per k over candidate numbers split by their prime factors, kept as reference
+unsigned long product_sum_total_reference()
+{
+    find_primes_to_n(PRIME_MAX);
+    build_factor_tables();
 
     std::array<int, 500> last_nums = {};
     int offset_last_nums = 0;
     const int last_nums_size = last_nums.size();
     unsigned long total_sum = 0;
     int start_num;
-    for( int k = 2; k <= 2e5; k++ )
+    for( int k = 2; k <= K_MAX; k++ )
     {
         int log2_ = log2(k);
         start_num = k + log2_;
@@ -178,6 +184,47 @@ int main()
         }
         if( !found ) std::cout << k << " NONE FOUND!!" << std::endl;
     }
-    std::cout << total_sum << std::endl;
+    return total_sum;
+}
+
+void unit_product_sum_test(uint32_t kmax, unsigned long expected)
+{
+    const auto res = product_sum_total(kmax);
+    std::cout << "TEST: " << kmax << "=" << res << " and expected: " << expected << std::endl;
+    assert( res == expected );
+}
+
+// the examples of the problem statement and the project euler 88 answer for k up to 12000
+void unit_product_sum_tests()
+{
+    unit_product_sum_test(6, 30);
+    unit_product_sum_test(12, 61);
+    unit_product_sum_test(12000, 7587457);
+}
+
+// ms of the factor list walk and of the per k search, the search builds the factor tables so it only runs here
+void benchmark_product_sums()
+{
+    auto start = high_resolution_clock::now();
+    const auto total = product_sum_total(K_MAX);
+    auto stop = high_resolution_clock::now();
+    std::cout << "product_sum_total: " << duration_cast<milliseconds>(stop - start).count() << "ms";
+
+    start = high_resolution_clock::now();
+    const auto reference = product_sum_total_reference();
+    stop = high_resolution_clock::now();
+    std::cout << ", reference: " << duration_cast<milliseconds>(stop - start).count() << "ms " << total << (total == reference ? "" : " MISMATCH") << std::endl;
+    assert( total == reference );
+}
+
+int main(int argc, char** argv)
+{
+    if( argc > 1 && std::string(argv[1]) == "bench" )
+    {
+        benchmark_product_sums();
+        return 0;
+    }
+    unit_product_sum_tests();
+    std::cout << product_sum_total(K_MAX) << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -5,78 +5,193 @@
 #include <algorithm>
 #include <cassert>
 #include <functional>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 #include "Primes.h"
+#include "ThreadPool.h"
 
+constexpr int N_MAX = 1e6 + 1;
 
 constexpr uint16_t MAX_FACTORS = 500;
 
-std::array<int, N_MAX> factor_sums = {};
+std::vector<uint32_t> factor_sums;
 
-void find_factor_sum_3000(const int num)
+struct AliquotCycle
 {
+    uint32_t smallest;
+    uint32_t length;
+};
 
-    auto all_factors = find_all_distinct_factors<MAX_FACTORS>(num);
+// every cycle of the functional graph n -> next(n) on 2..limit, a step leaving that range ends the walk
+// a node's byte state is unseen, the id of the start range walking it, or done, so each node is walked once
+// a walk that runs into the path of another range is undone and repeated serially after the parallel pass
+template<typename Next>
+std::vector<AliquotCycle> find_cycles(uint32_t limit, const Next& next, ThreadPool* pool = nullptr)
+{
+    constexpr uint8_t unseen = 0;
+    constexpr uint8_t done = 255;
+    std::vector<std::atomic<uint8_t>> state(limit + 1);
+    std::vector<AliquotCycle> cycles;
+    std::vector<uint32_t> deferred;
+    std::mutex result_mutex;
+
+    // returns false when the walk met a foreign path and has to be repeated
+    auto walk = [&](uint32_t start, uint8_t id, std::vector<uint32_t>& path)
+    {
+        path.clear();
+        bool blocked = false;
+        uint64_t n = start;
+        while( n >= 2 && n <= limit )
+        {
+            uint8_t seen = unseen;
+            if( state[n].compare_exchange_strong(seen, id) )
+            {
+                path.push_back(n);
+                n = next(n);
+                continue;
+            }
+            if( seen == id )
+            {
+                // back on the own path, n lies on a new cycle
+                AliquotCycle cycle = {(uint32_t)n, 0};
+                uint64_t m = n;
+                do
+                {
+                    cycle.smallest = std::min<uint32_t>(cycle.smallest, m);
+                    cycle.length++;
+                    m = next(m);
+                } while( m != n );
+                std::lock_guard<std::mutex> lock(result_mutex);
+                cycles.push_back(cycle);
+            }
+            else if( seen != done ) blocked = true;
+            break;
+        }
+        for( const auto m: path ) state[m].store(blocked ? unseen : done);
+        return !blocked;
+    };
+
+    auto walk_range = [&](uint32_t begin, uint32_t end, uint8_t id)
+    {
+        std::vector<uint32_t> path;
+        std::vector<uint32_t> blocked;
+        for( uint32_t start = begin; start < end; start++ )
+        {
+            if( state[start].load() != unseen ) continue;
+            if( !walk(start, id, path) ) blocked.push_back(start);
+        }
+        std::lock_guard<std::mutex> lock(result_mutex);
+        deferred.insert(deferred.end(), blocked.begin(), blocked.end());
+    };
 
-    int sum = 0;
-    for( const auto f: all_factors )
+    const uint32_t first = 2;
+    const uint32_t end = limit + 1;
+    if( pool == nullptr || end <= first )
+    {
+        walk_range(first, std::max(first, end), 1);
+    }
+    else
     {
-        if( f == 0 ) break;
-        sum+= f;
+        // range ids 1..254 have to be unique among the ranges in flight
+        const uint32_t ranges = std::min<uint32_t>(254, std::min<uint32_t>(pool->size() * 16, end - first));
+        const uint32_t step = (end - first + ranges - 1) / ranges;
+        for( uint32_t r = 0; r < ranges; r++ )
+        {
+            const uint32_t begin = first + r * step;
+            const uint32_t range_end = std::min(end, begin + step);
+            if( begin >= range_end ) break;
+            pool->submit([&walk_range, begin, range_end, r]{ walk_range(begin, range_end, r + 1); });
+        }
+        pool->wait();
+        std::sort(deferred.begin(), deferred.end());
+        std::vector<uint32_t> path;
+        for( const auto start: deferred )
+        {
+            if( state[start].load() == unseen ) walk(start, 1, path);
+        }
     }
-    factor_sums[num] = sum;
+
+    std::sort(cycles.begin(), cycles.end(), [](const AliquotCycle& a, const AliquotCycle& b){ return a.smallest < b.smallest; });
+    return cycles;
 }
 
-int main()
+// smallest member of the longest cycle, ties go to the smaller member
+uint32_t longest_cycle_member(const std::vector<AliquotCycle>& cycles)
 {
-    find_primes_to_n();
+    uint32_t longest = 0;
+    uint32_t res = 0;
+    for( const auto& cycle: cycles )
+    {
+        if( cycle.length > longest )
+        {
+            longest = cycle.length;
+            res = cycle.smallest;
+        }
+    }
+    return res;
+}
 
-    int N;
-    N=2e4;
-    for(int i = 2; i < N_MAX; i++)
+// serial and pooled cycle search over the aliquot sums below 1e6
+void benchmark_cycles()
+{
+    const auto sums = aliquot_sums<uint32_t>(N_MAX);
+    const auto next = [&sums](uint64_t n){ return sums[n]; };
+    for( ThreadPool* p: {(ThreadPool*)nullptr, &shared_pool()} )
     {
-        find_factor_sum_3000(i);
+        auto start = std::chrono::high_resolution_clock::now();
+        const auto cycles = find_cycles(N_MAX - 1, next, p);
+        auto stop = std::chrono::high_resolution_clock::now();
+        std::cout << "find_cycles to " << N_MAX - 1 << (p ? " pooled: " : " serial: ")
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << "ms, "
+                  << cycles.size() << " cycles, answer " << longest_cycle_member(cycles) << std::endl;
     }
+}
 
-    // find_factor_sum_3000(97846);
-    //std::cout << factor_sums[97846] << std::endl;
-    // assert(factor_sums[97846] == 76394);
+// aliquot sums from the divisor sieve against the per number divisor lists they replace
+void benchmark_factor_sums()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto sums = aliquot_sums<uint32_t>(N_MAX);
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::cout << "aliquot_sums to " << N_MAX << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << "ms";
 
-    // find chains
-    int longest_chain = 0;
-    int res = 1e7;
-    for( int i = 2; i <= N; i++ )
+    start = std::chrono::high_resolution_clock::now();
+    smallest_prime_factors.build(N_MAX);
+    int mismatches = 0;
+    for( int i = 2; i < N_MAX; i++ )
     {
-        std::vector<int> chain = {};
-        int current_el = i;
-        do
-        {
-            chain.push_back( current_el );
-            current_el = factor_sums[current_el];
-        } while ( std::find( chain.begin(), chain.end(), current_el ) == chain.end() && current_el <= N && current_el > 1 );
-
-        if( current_el > 1 && current_el <= N )
+        const auto all_factors = find_all_distinct_factors<MAX_FACTORS>(i);
+        uint64_t sum = 0;
+        for( const auto f: all_factors )
         {
-            const auto found = std::find( chain.begin(), chain.end(), current_el );
-            const int chain_len = chain.size() - (found - chain.begin());
-            // std::cout << "found chain with len " << chain_len << std::endl;
-            if( chain_len >= longest_chain )
-            {
-                int smallest_mem = *found;
-                for(auto it = found+1; it != chain.end(); it++)
-                {
-                    smallest_mem = std::min(*it, smallest_mem);
-                }
-                if( chain_len > longest_chain ) res = smallest_mem;
-                else
-                {
-                    // std::cout << "CHAIN FOUND SAME LEN ";
-                    // std::cout << std::endl;
-                    res = std::min(res, smallest_mem);
-                }
-                longest_chain = chain_len;
-            }
+            if( f == 0 ) break;
+            sum += f;
         }
+        if( sum != sums[i] ) mismatches++;
+    }
+    stop = std::chrono::high_resolution_clock::now();
+    std::cout << ", find_all_distinct_factors: " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << "ms";
+    std::cout << (mismatches == 0 ? " PASS" : " FAIL") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if( argc > 1 && std::string(argv[1]) == "bench" )
+    {
+        benchmark_factorize();
+        benchmark_is_prime();
+        benchmark_factorize_u64();
+        benchmark_factor_sums();
+        benchmark_cycles();
+        return 0;
     }
-    std::cout << res << std::endl;
+    factor_sums = aliquot_sums<uint32_t>(N_MAX);
+
+    int N;
+    N=2e4;
+
+    const auto cycles = find_cycles(N, [](uint64_t n){ return factor_sums[n]; }, &shared_pool());
+    std::cout << longest_cycle_member(cycles) << std::endl;
     return 0;
-}
\ No newline at end of file
+}